@@ -0,0 +1,109 @@
+/*
+    Benchmark of the Goertzel engine - Part of the SRCclock program.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/* Compares the float and the 16 bit fixed point paths of Cgoertzel on the symbols of the SRC (F0 and F1 over windows
+   of 30 ms at 8 kHz): samples per second of each path, largest difference of the power of the two paths over the
+   powers that may cross a decision threshold, and decisions taken differently by the two paths. The float path is
+   fed the same 16 bit samples divided by 32768, so the two paths differ only by the arithmetic. The level of the
+   tones sweeps from -60 to 0 dB, so every threshold tested is crossed many times.
+
+   Usage: goertzel_bench [SECONDS]	(seconds of signal processed by each path, default 600)
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include "cgoertzel.h"
+
+
+#define FC		8000
+#define WINDOW		240	// samples of a symbol
+#define LENGTH		(60*FC)	// samples of the test signal: one minute
+#define STEP		5	// dB between the thresholds tested
+
+
+
+int main(int argc, char** argv)
+{
+  const int seconds = (argc > 1) ? atoi(argv[1]) : 600;
+  const int windows = LENGTH/WINDOW;
+  const Cgoertzel engine(FC, 2000, 2500);
+  std::vector<float> x(LENGTH);
+  std::vector<int16_t> q(LENGTH);
+  std::vector<double> pf(2*windows), pq(2*windows);
+  double worst = 0.0, sink = 0.0;
+  int passes, decisions = 0, differ = 0;
+
+  if(seconds <= 0) {
+    std::cerr <<"Usage: " <<argv[0] <<" [SECONDS]\n";
+    return 1;
+  }
+  passes = (seconds*FC + LENGTH - 1)/LENGTH;
+
+  srand(1);
+  for(int i = 0; i < LENGTH; i++) {	// tones F0 and F1 alternated every symbol, from -60 to 0 dB, with noise at -50 dB
+    const int f = ((i/WINDOW) % 2) ? 2500 : 2000;
+    const double a = pow(10.0, (-60.0 + 60.0*i/LENGTH)/20);
+    q[i] = int16_t(lrint(32767*(a*sin(2*M_PI*f*i/FC) + 0.00316*(2.0*rand()/RAND_MAX - 1.0)*sqrt(3.0))));
+    x[i] = q[i]*(1.0f/32768);
+  }
+
+
+  std::chrono::high_resolution_clock::time_point t0 = std::chrono::high_resolution_clock::now();
+  for(int k = 0; k < passes; k++)
+    for(int w = 0; w < windows; w++) engine.power(&x[w*WINDOW], WINDOW, &pf[2*w]);
+  std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
+  for(int k = 0; k < passes; k++)
+    for(int w = 0; w < windows; w++) engine.power(&q[w*WINDOW], WINDOW, &pq[2*w]);
+  std::chrono::high_resolution_clock::time_point t2 = std::chrono::high_resolution_clock::now();
+
+  for(int i = 0; i < 2*windows; i++) {
+    const double d = fabs(10*log10(pq[i]/pf[i]));
+    if((pf[i] > 1e-5) && (d > worst)) worst = d;	// far below, the quantization of the samples prevails
+    sink += pf[i] + pq[i];
+  }
+
+  for(int w = 0; w < windows; w++) {	// the decisions of the decoder: the stronger tone, and the power over a threshold
+    if((pf[2*w] > pf[2*w+1]) != (pq[2*w] > pq[2*w+1])) differ++;
+    for(int th = -60; th <= 0; th += STEP) {
+      const double t = pow(10.0, th/10.0);
+      if((pf[2*w] > t) != (pq[2*w] > t)) differ++;
+      if((pf[2*w+1] > t) != (pq[2*w+1] > t)) differ++;
+      decisions += 2;
+    }
+    decisions++;
+  }
+
+  const double tf = std::chrono::duration<double>(t1 - t0).count();
+  const double tq = std::chrono::duration<double>(t2 - t1).count();
+  const double samples = double(passes)*windows*WINDOW;
+
+  std::cout <<"Goertzel engine: " <<Cgoertzel::simd_name() <<"; 2 tones; windows of " <<WINDOW <<" samples\n"
+	    <<std::fixed <<std::setprecision(0)
+	    <<"float:\t\t" <<samples/tf <<" samples/s\n"
+	    <<"16 bit fixed:\t" <<samples/tq <<" samples/s\n"
+	    <<std::setprecision(6)
+	    <<"largest difference of the power above -50 dB: " <<worst <<" dB\n"
+	    <<"decisions taken differently: " <<differ <<" of " <<decisions <<" (thresholds from -60 to 0 dB every " <<STEP <<" dB)\n";
+
+  return (sink > 0.0) ? 0 : 1;
+}
@@ -0,0 +1,295 @@
+/*
+    Monte Carlo characterisation of the decoder - Part of the SRCclock program.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/* Sensitivity of the decoder over a sweep of SNR, frequency offsets, drifts of the sampling clock and phases of the
+   tones. Each trial synthesizes in memory (Ccorpus) 3 minutes from a random date, with the phase of the tones (random
+   if not given) and AWGN, and feeds
+   them to a Cdecoder from a random sample of the first minute, like a receiver switched on at a random time. The
+   decoder restarts after each decoding till the first minute syncronised or the end of the signal. For each
+   configuration it prints:
+	phase		phase of the tones in degrees, or "rand"
+	lock		trials syncronised on the right date (%)
+	false		trials syncronised on a wrong date (%)
+	frame		frames decoded but not syncronised, per trial
+	ttl		time to lock: seconds of signal fed till the first right syncronisation (median and 90th percentile)
+	error		error of the timing of the second 0 in us: mean, standard deviation, 95th percentile and
+			maximum of the absolute value
+   The trials run on all the cores; the trial k is seeded with SEED + k, so the results do not depend on the threads.
+   A sweep of the phase at high SNR checks that the error of the timing stays within half a sample whatever the phase,
+   e.g. montecarlo -s 20 -p 0,15,30,45,60,75,90,105,120,135,150,165
+
+   Usage: montecarlo [OPTIONS]
+	-s SNR[,SNR...]		SNR of the tones in dB over the whole band (default
+				-12,-10,-8,-6,-3,0)
+	-o HZ[,HZ...]		frequency offsets (default 0)
+	-d PPM[,PPM...]		drifts of the sampling clock (default 0)
+	-p DEG[,DEG...]		phases of the tones (default random)
+	-n TRIALS		trials of each configuration (default 200)
+	-j THREADS		threads (default one for each core)
+	-g SEED			seed (default 1)
+	-t DB, -W SYMBOLS, -N DB, -A ESTIMATOR, -F SCORE, -Y BITS
+				decoding settings as the options of srcclock (defaults -35, 50, 5, mean, 0, 0)
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include "csrc.h"
+#include "ccorpus.h"
+
+
+#define FC		8000
+#define MINUTES		3
+
+
+
+struct Ctrial {
+  bool locked;			// syncronised on the right date
+  bool wrong;			// syncronised on a wrong date
+  int frames;			// frames decoded but not syncronised
+  double ttl;			// seconds
+  double error;			// us
+};
+
+
+struct Cconfig {
+  double snr, offset, drift, phase;	// phase < 0: random
+};
+
+
+struct Csettings {
+  double th, snr_level, frame;
+  int wds, estimator, corrections;
+};
+
+
+
+static std::vector<double> list(const char* s)
+{
+  std::vector<double> v;
+  std::stringstream ss(s);
+  std::string item;
+
+  while(std::getline(ss, item, ',')) v.push_back(atof(item.c_str()));
+
+  return v;
+}
+
+
+static void trial(const Cconfig& c, const Csettings& s, uint64_t seed, Ctrial& t)
+{
+  Crandom random(seed);
+  Csrc gen, src;
+  std::vector<float> x;
+  std::stringstream labels;
+  std::map<std::string, double> second0;	// sample of the second 0 of each date
+  std::string line;
+  Cimpairments impairments;
+  char date[64];
+
+  t.locked = t.wrong = false;
+  t.frames = 0;
+  t.ttl = t.error = 0.0;
+
+  gen.set_verbose(0);
+  snprintf(date, sizeof(date), "%02d:%02d %02d/%02d/%d", random.below(24), random.below(60), 1 + random.below(28),
+           1 + random.below(12), 2000 + random.below(100));
+  gen.set(date, "%H:%M %d/%m/%Y");
+
+  impairments.snr.push_back(c.snr);
+  impairments.offset = c.offset;
+  impairments.phase = (c.phase < 0.0) ? 360.0*random.uniform() : c.phase;
+  impairments.drift = c.drift;
+  impairments.fade_depth = 0.0;
+  impairments.fade_period = 10.0;
+  impairments.program_level = 0.0;
+
+  Ccorpus corpus(gen);
+  corpus.set_impairments(impairments);
+  corpus.set_seed(seed);
+  corpus.set_labels(&labels);
+  corpus.set_memory(&x);
+  corpus.generate(MINUTES, 1);
+
+  while(std::getline(labels, line)) {
+    std::stringstream fields(line);
+    std::string frame, sync, d;
+    std::getline(fields, frame, '\t');
+    std::getline(fields, sync, '\t');
+    std::getline(fields, d, '\t');
+    second0[d] = atof(sync.c_str());
+  }
+
+  src.set_verbose(0);
+  src.set_decision_threshold(s.th);
+  src.setWDS(s.wds, s.snr_level);
+  src.set_noise_estimator(s.estimator);
+  src.set_frame_detection(s.frame);
+  src.set_corrections(s.corrections);
+
+  const long long start = random.below(60*FC);	// the receiver is switched on at a random time of the first minute
+  Cdecoder decoder(src);
+  Cevent e;
+  bool synced = false;
+  long long sync = 0;
+  double fraction = 0.0;
+
+  for(long long k = start; k < (long long)x.size(); ) {
+    int n = decoder.wanted();
+    if(n <= 0) n = 1;
+    if(k + n > (long long)x.size()) n = x.size() - k;
+
+    decoder.feed(&x[k], n);
+    k += n;
+
+    while(decoder.event(e))
+      if(e.type == EVENT_SYNC) {
+        synced = true;
+        sync = e.sample;
+        fraction = e.fraction;
+      }
+
+    if(!decoder.done()) continue;
+
+    if(src.OK() && synced) {
+      const std::map<std::string, double>::const_iterator i = second0.find(src.dateSTR());
+      if(i == second0.end()) t.wrong = true;
+      else {	// as for srcclock, the sync sample is captured at reference_time(), getMilliseconds() after the second 0
+        t.locked = true;
+        t.ttl = double(sync)/FC;
+        t.error = ((start + sync + fraction - src.getMilliseconds()*1e-3*FC) - i->second)/FC*1e6;
+      }
+      return;
+    }
+    if(src.OK()) t.frames++;
+    synced = false;
+    decoder.start();
+  }
+}
+
+
+
+int main(int argc, char** argv)
+{
+  std::vector<double> snrs = list("-12,-10,-8,-6,-3,0"), offsets(1, 0.0), drifts(1, 0.0), phases(1, -1.0);
+  std::vector<Cconfig> configs;
+  Csettings s = {-35.0, 5.0, 0.0, 50, NOISE_MEAN, 0};
+  int trials = 200, threads = 0, choice;
+  uint64_t seed = 1;
+
+  while((choice = getopt(argc, argv, "s:o:d:p:n:j:g:t:W:N:A:F:Y:h")) != -1) {
+    switch(choice) {
+      case 's': snrs = list(optarg);
+		break;
+      case 'o': offsets = list(optarg);
+		break;
+      case 'd': drifts = list(optarg);
+		break;
+      case 'p': phases = list(optarg);
+		for(unsigned int i = 0; i < phases.size(); i++) phases[i] = fabs(phases[i]);
+		break;
+      case 'n': trials = atoi(optarg);
+		break;
+      case 'j': threads = atoi(optarg);
+		break;
+      case 'g': seed = strtoull(optarg, NULL, 0);
+		break;
+      case 't': s.th = atof(optarg);
+		break;
+      case 'W': s.wds = atoi(optarg);
+		break;
+      case 'N': s.snr_level = atof(optarg);
+		break;
+      case 'A': s.estimator = (optarg[0] == 'e') ? NOISE_EWMA : (optarg[0] == 'p') ? NOISE_PERCENTILE : NOISE_MEAN;
+		break;
+      case 'F': s.frame = atof(optarg);
+		break;
+      case 'Y': s.corrections = atoi(optarg);
+		break;
+      default:	std::cerr <<"Usage: " <<argv[0] <<" [-s SNR,...] [-o HZ,...] [-d PPM,...] [-p DEG,...] [-n TRIALS] [-j THREADS] [-g SEED]\n"
+			  <<"\t[-t DB] [-W SYMBOLS] [-N DB] [-A mean|ewma|percentile] [-F SCORE] [-Y BITS]\n";
+		return 1;
+    }
+  }
+  if(trials <= 0) trials = 1;
+  if(threads <= 0) threads = std::thread::hardware_concurrency();
+  if(threads <= 0) threads = 1;
+
+  for(unsigned int i = 0; i < snrs.size(); i++)
+    for(unsigned int j = 0; j < offsets.size(); j++)
+      for(unsigned int k = 0; k < drifts.size(); k++)
+        for(unsigned int l = 0; l < phases.size(); l++) configs.push_back({snrs[i], offsets[j], drifts[k], phases[l]});
+
+  const long long total = (long long)configs.size()*trials;
+  std::vector<Ctrial> results(total);
+  std::vector<std::thread> pool;
+  std::atomic<long long> next(0);
+  const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+  for(int t = 0; t < threads; t++)
+    pool.push_back(std::thread([&]() {
+      long long k;
+      while((k = next++) < total) trial(configs[k/trials], s, seed + k, results[k]);
+    }));
+  for(int t = 0; t < threads; t++) pool[t].join();
+
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+  std::cout <<"snr (dB)\toffset (Hz)\tdrift (ppm)\tphase\tlock (%)\tfalse (%)\tframe\tttl (s)\t\terror (us)\n"
+            <<"\t\t\t\t\t\t\t\t\t\t\t\tmedian\tp90\tmean\tstd\tp95\tmax\n";
+  for(unsigned int c = 0; c < configs.size(); c++) {
+    Chistogram ttl(0.25, 800), error(1.0, 100000), abs_error(1.0, 100000);
+    int locked = 0, wrong = 0, frames = 0;
+
+    for(int i = 0; i < trials; i++) {
+      const Ctrial& r = results[(long long)c*trials + i];
+      if(r.locked) {
+        locked++;
+        ttl.add(r.ttl);
+        error.add(r.error);
+        abs_error.add(fabs(r.error));
+      }
+      if(r.wrong) wrong++;
+      frames += r.frames;
+    }
+
+    std::cout <<std::fixed <<std::setprecision(1) <<configs[c].snr <<"\t\t" <<configs[c].offset <<"\t\t" <<configs[c].drift <<"\t\t";
+    if(configs[c].phase < 0.0) std::cout <<"rand\t";
+    else std::cout <<configs[c].phase <<'\t';
+    std::cout <<100.0*locked/trials <<"\t\t" <<100.0*wrong/trials <<"\t\t" <<std::setprecision(2) <<double(frames)/trials <<'\t';
+    if(locked > 0)
+      std::cout <<std::setprecision(2) <<ttl.percentile(0.5) <<'\t' <<ttl.percentile(0.9) <<'\t' <<std::setprecision(1)
+                <<error.mean() <<'\t' <<error.stddev() <<'\t' <<abs_error.percentile(0.95) <<'\t' <<abs_error.max() <<'\n';
+    else std::cout <<"-\t-\t-\t-\t-\t-\n";
+  }
+
+  std::cerr <<total <<" trials in " <<std::fixed <<std::setprecision(1) <<seconds <<" s on " <<threads <<" threads ("
+            <<total/seconds <<" trials/s)\n";
+
+  return 0;
+}
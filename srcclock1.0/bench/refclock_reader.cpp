@@ -0,0 +1,131 @@
+/*
+    Reader of the reference clock - Part of the SRCclock program.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/* Reads the samples published by srcclock -U or -O as ntpd and chronyd do, without a daemon: polls the SHM segment of
+   a unit (mode 1: the sample is taken only if count did not change while reading it) or binds the socket of a SOCK
+   refclock. Prints the true time, the system time and the offset of each sample.
+
+   Usage: refclock_reader shm UNIT [SAMPLES]
+	  refclock_reader sock PATH [SAMPLES]	(SAMPLES to read before exiting, default 0 = unlimited)
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "crefclock.h"
+
+
+#define POLL		100000	// polling interval of the SHM segment in microseconds
+
+
+
+static void print(double clock, double receive, int leap)
+{
+  std::cout <<std::fixed <<std::setprecision(6) <<clock <<'\t' <<receive <<"\toffset " <<std::setprecision(1)
+	    <<(clock - receive)*1e6 <<" us\tleap " <<leap <<std::endl;
+}
+
+
+static int read_shm(int unit, int samples)
+{
+  const int id = shmget(SHM_KEY + unit, sizeof(Cshmtime), IPC_CREAT | ((unit <= 1) ? 0600 : 0666));
+  volatile Cshmtime* shm;
+  void* p;
+
+  if((id < 0) || ((p = shmat(id, NULL, 0)) == (void*)-1)) {
+    std::cerr <<"Unable to attach the SHM segment of the unit " <<unit <<'\n';
+    return 1;
+  }
+  shm = (volatile Cshmtime*)p;
+
+  for(int n = 0; (samples == 0) || (n < samples); usleep(POLL)) {
+    if(!shm->valid) continue;
+
+    const int count = shm->count;
+    __sync_synchronize();
+    const double clock = shm->clockTimeStampSec + shm->clockTimeStampNSec*1e-9;
+    const double receive = shm->receiveTimeStampSec + shm->receiveTimeStampNSec*1e-9;
+    const int leap = shm->leap;
+    __sync_synchronize();
+
+    if((shm->mode == 1) && (count != shm->count)) {	// written while reading: the next poll takes it again
+      std::cerr <<"sample being written, skipped\n";
+      continue;
+    }
+    shm->valid = 0;
+
+    print(clock, receive, leap);
+    n++;
+  }
+
+  shmdt((const void*)shm);
+  return 0;
+}
+
+
+static int read_sock(const char* path, int samples)
+{
+  const int sock = socket(AF_UNIX, SOCK_DGRAM, 0);
+  sockaddr_un addr;
+  Csocksample s;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+  unlink(path);
+  if((sock < 0) || (bind(sock, (const sockaddr*)&addr, sizeof(addr)) < 0)) {
+    std::cerr <<"Unable to bind the socket " <<path <<'\n';
+    return 1;
+  }
+
+  for(int n = 0; (samples == 0) || (n < samples); ) {
+    if(recv(sock, &s, sizeof(s), 0) != sizeof(s)) continue;
+    if(s.magic != SOCK_MAGIC) {
+      std::cerr <<"wrong magic number\n";
+      continue;
+    }
+
+    const double receive = s.tv.tv_sec + s.tv.tv_usec*1e-6;
+    print(receive + s.offset, receive, s.leap);
+    n++;
+  }
+
+  close(sock);
+  unlink(path);
+  return 0;
+}
+
+
+
+int main(int argc, char** argv)
+{
+  const int samples = (argc > 3) ? atoi(argv[3]) : 0;
+
+  if((argc > 2) && (strcmp(argv[1], "shm") == 0)) return read_shm(atoi(argv[2]), samples);
+  if((argc > 2) && (strcmp(argv[1], "sock") == 0)) return read_sock(argv[2], samples);
+
+  std::cerr <<"Usage: " <<argv[0] <<" shm UNIT [SAMPLES]\n\t" <<argv[0] <<" sock PATH [SAMPLES]\n";
+  return 1;
+}
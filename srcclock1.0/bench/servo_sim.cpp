@@ -0,0 +1,88 @@
+/*
+    Simulation of the clock discipline - Part of the SRCclock program.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/* Disciplines a simulated clock (Csimclock) with the servo of the option --discipline (Cservo), one offset for each
+   minute as given by the SRC. Prints the offset measured, the true offset and the frequency correction of each minute,
+   then the RMS of the true offset and the error of the frequency over the last half of the run.
+
+   Usage: servo_sim [PPM [OFFSET_MS [JITTER_US [MINUTES [STEP_MS]]]]]
+	  (frequency error of the clock, default 50 ppm; initial offset, default 20 ms; jitter of the measure, default
+	   100 us; minutes simulated, default 240; step threshold, default 128 ms)
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <cstdlib>
+#include "cclock.h"
+#include "cservo.h"
+
+
+#define MINUTE		60.0
+#define START		1.4e9	// reference time of the first offset (2014)
+
+
+
+int main(int argc, char** argv)
+{
+  const double ppm = (argc > 1) ? atof(argv[1]) : 50.0;
+  const double initial = (argc > 2) ? atof(argv[2]) : 20.0;
+  const double jitter = (argc > 3) ? atof(argv[3]) : 100.0;
+  const int minutes = (argc > 4) ? atoi(argv[4]) : 240;
+  const double step = (argc > 5) ? atof(argv[5]) : 128.0;
+  Csimclock clock(initial*1e-3, ppm*1e-6, jitter*1e-6);
+  Cservo servo(step*1e-3);
+  double rms = 0.0, ferr = 0.0;
+  int n = 0;
+
+  if(minutes <= 0) {
+    std::cerr <<"Usage: " <<argv[0] <<" [PPM [OFFSET_MS [JITTER_US [MINUTES [STEP_MS]]]]]\n";
+    return 1;
+  }
+
+  std::cout <<"minute\toffset (us)\ttrue (us)\tfrequency (ppm)\tjitter (us)\n" <<std::fixed;
+  for(int m = 0; m < minutes; m++) {
+    const double reference = START + m*MINUTE;
+    const double offset = clock.offset(reference);
+    const double truth = clock.true_offset();
+
+    switch(servo.update(offset, reference)) {
+      case SERVO_STEP:	clock.step(servo.get_step());
+			break;
+      case SERVO_SLEW:	clock.slew(servo.get_phase(), servo.get_frequency());
+			break;
+      default:		break;
+    }
+
+    std::cout <<m <<'\t' <<std::setprecision(1) <<offset*1e6 <<'\t' <<truth*1e6 <<'\t'
+	      <<std::setprecision(3) <<clock.frequency()*1e6 <<'\t' <<std::setprecision(1) <<servo.get_jitter()*1e6
+	      <<((servo.get_step() != 0.0) ? "\tstep" : "") <<'\n';
+
+    if(m >= minutes/2) {	// the servo has settled
+      rms += truth*truth;
+      ferr += fabs(clock.frequency() + ppm*1e-6);
+      n++;
+    }
+  }
+
+  std::cout <<std::setprecision(1) <<"RMS of the true offset: " <<sqrt(rms/n)*1e6 <<" us; mean error of the frequency: "
+	    <<std::setprecision(4) <<ferr/n*1e6 <<" ppm\n";
+
+  return 0;
+}
@@ -0,0 +1,344 @@
+/*
+    Benchmark suite - Part of the SRCclock program.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/* Throughput of the hot paths of the program at 8, 16, 44.1 and 48 kHz, mono and stereo, in samples per second of
+   the stream and as a multiple of real time:
+	goertzel	Cgoertzel on the symbols of the frame (windows of 30 ms)
+	goertzel_s16	the same on 16 bit samples (fixed point)
+	resample	Cresampler decimating to 8 kHz
+	play		Csrc::play() of the frame and of the RP (encode(), wavetables, noise, channels) to a file
+	corpus		Ccorpus on one thread: continuous minutes to a file
+	read		Csrc::readBuffer() of a file (channels averaged, decimated to 8 kHz)
+	decode		Csrc::decode() with syncronisation of every minute of a file, decimated to 8 kHz
+   Every benchmark is run 3 times and the fastest run is kept. The results are printed in JSON, one benchmark for each
+   line, so the output can be stored as a baseline: the results more than TOLERANCE % slower than the same benchmark
+   of the baseline are reported on stderr and the exit status is 2.
+
+   Usage: srcclock_bench [MINUTES [BASELINE [TOLERANCE]]]
+	  (minutes of signal of each benchmark, default 10; baseline file, - for none; tolerance in %, default 15)
+*/
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "csrc.h"
+#include "ccorpus.h"
+
+
+#define FC		8000	// rate of the decoder
+#define WINDOW		0.03	// seconds of a symbol
+#define RUNS		3
+#define DATE		"10:00 16/10/2026"
+
+
+struct Cresult {
+  std::string name;
+  int rate, channels;
+  double samples_per_s;		// samples of the stream (frames, if stereo) per second
+};
+
+
+static std::string tmpdir;
+
+
+
+// runs f RUNS times and returns the shortest time
+template<class F> static double best(F f)
+{
+  double t = 1e300;
+
+  for(int r = 0; r < RUNS; r++) {
+    const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    f();
+    const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if(s < t) t = s;
+  }
+
+  return t;
+}
+
+
+static std::string file_name(int rate, int channels)
+{
+  return tmpdir + "/src_" + std::to_string(rate) + "_" + std::to_string(channels) + ".raw";
+}
+
+
+static long long file_samples(const std::string& name, int channels)
+{
+  struct stat st;
+
+  return (stat(name.c_str(), &st) == 0) ? st.st_size/(sizeof(float)*channels) : 0;
+}
+
+
+
+static double goertzel(int rate, double seconds, bool s16)
+{
+  const int window = lrint(WINDOW*rate);
+  const int windows = lrint(seconds/WINDOW);
+  const Cgoertzel engine(rate, 2000, 2500);
+  std::vector<float> x(window*100);
+  std::vector<int16_t> q(x.size());
+  double p[2], sink = 0.0;
+
+  for(unsigned int i = 0; i < x.size(); i++) {
+    q[i] = int16_t(lrint(16384*sin(2*M_PI*2000.0*i/rate)));
+    x[i] = q[i]*(1.0f/32768);
+  }
+
+  const double t = best([&]() {
+    for(int w = 0; w < windows; w++) {
+      const int k = (w % 100)*window;
+      if(s16) engine.power(&q[k], window, p);
+      else engine.power(&x[k], window, p);
+      sink += p[0];
+    }
+  });
+
+  return (sink > 0.0) ? double(windows)*window/t : 0.0;
+}
+
+
+static double resample(int rate, double seconds)
+{
+  const int block = rate/10;
+  const int blocks = lrint(seconds*10);
+  Cresampler resampler(rate, FC);
+  std::vector<float> x(block), y(block);
+
+  for(int i = 0; i < block; i++) x[i] = 0.5*sin(2*M_PI*2000.0*i/rate);
+
+  const double t = best([&]() {
+    resampler.reset();
+    for(int b = 0; b < blocks; b++) resampler.process(&x[0], block, &y[0]);
+  });
+
+  return double(blocks)*block/t;
+}
+
+
+static double play(int rate, int channels, int minutes)
+{
+  const std::string name = tmpdir + "/play.raw";
+  long long samples = 0;
+
+  const double t = best([&]() {
+    Csrc src;
+    src.set_verbose(0);
+    src.set_seed(1);
+    src.open_file_output(name.c_str(), rate, channels);
+    src.set(DATE, "%H:%M %d/%m/%Y");
+    for(int m = 0; m < minutes; m++) src.play(-6, false, false, 0.01);
+    src.close_all();
+  });
+
+  samples = file_samples(name, channels);
+  unlink(name.c_str());
+
+  return samples/t;
+}
+
+
+static double corpus(int rate, int channels, int minutes)
+{
+  const std::string name = file_name(rate, channels);
+
+  const double t = best([&]() {	// the file of the last run is kept for read and decode
+    Csrc src;
+    src.set_verbose(0);
+    src.open_file_output(name.c_str(), rate, channels);
+    src.set(DATE, "%H:%M %d/%m/%Y");
+
+    Ccorpus c(src);
+    c.set_impairments("snr=20");
+    c.set_seed(1);
+    c.generate(minutes, 1);
+    src.close_all();
+  });
+
+  return file_samples(name, channels)/t;
+}
+
+
+static double read(int rate, int channels)
+{
+  const std::string name = file_name(rate, channels);
+  const long long samples = file_samples(name, channels);
+  std::vector<float> x(FC/10*channels);
+
+  const double t = best([&]() {
+    Csrc src;
+    src.set_verbose(0);
+    src.set_decimation(true);
+    src.open_file_input(name.c_str(), rate, channels);
+    src.start();
+    while(src.readBuffer(&x[0], FC/10) > 0) ;
+    src.close_all();
+  });
+
+  return samples/t;
+}
+
+
+static double decode(int rate, int channels, int minutes)
+{
+  const std::string name = file_name(rate, channels);
+  const long long samples = file_samples(name, channels);
+  int decoded = 0;
+
+  const double t = best([&]() {
+    Csrc src;
+    src.set_verbose(0);
+    src.set_decimation(true);
+    src.open_file_input(name.c_str(), rate, channels);
+    decoded = 0;
+    for(int m = 0; m < minutes; m++)
+      if(src.decode() && src.sincronized()) decoded++;
+    src.close_all();
+  });
+
+  if(decoded != minutes)
+    std::cerr <<"WW: decode " <<rate <<" Hz, " <<channels <<" channels: " <<decoded <<" minutes out of " <<minutes <<'\n';
+
+  return samples/t;
+}
+
+
+
+static void print(std::ostream& os, const std::vector<Cresult>& results)
+{
+  os <<"{\n  \"simd\": \"" <<Cgoertzel::simd_name() <<"\",\n  \"benchmarks\": [\n";
+  for(unsigned int i = 0; i < results.size(); i++) {
+    const Cresult& r = results[i];
+    os <<"    {\"name\": \"" <<r.name <<"\", \"rate\": " <<r.rate <<", \"channels\": " <<r.channels
+       <<", \"samples_per_s\": " <<std::fixed <<std::setprecision(0) <<r.samples_per_s
+       <<", \"realtime\": " <<std::setprecision(2) <<r.samples_per_s/r.rate <<'}' <<((i + 1 < results.size()) ? "," : "") <<'\n';
+  }
+  os <<"  ]\n}\n";
+}
+
+
+// reads the benchmarks of a file written by print()
+static bool load(const char* name, std::vector<Cresult>& results)
+{
+  std::ifstream in(name);
+  std::string line;
+  char id[64];
+  Cresult r;
+
+  if(!in) return false;
+
+  while(std::getline(in, line))
+    if(sscanf(line.c_str(), " {\"name\": \"%63[^\"]\", \"rate\": %d, \"channels\": %d, \"samples_per_s\": %lf",
+              id, &r.rate, &r.channels, &r.samples_per_s) == 4) {
+      r.name = id;
+      results.push_back(r);
+    }
+
+  return true;
+}
+
+
+// returns the number of regressions
+static int compare(const std::vector<Cresult>& results, const std::vector<Cresult>& baseline, double tolerance)
+{
+  int regressions = 0;
+
+  for(unsigned int i = 0; i < results.size(); i++)
+    for(unsigned int j = 0; j < baseline.size(); j++) {
+      const Cresult& r = results[i];
+      const Cresult& b = baseline[j];
+
+      if((r.name != b.name) || (r.rate != b.rate) || (r.channels != b.channels) || (b.samples_per_s <= 0.0)) continue;
+
+      const double change = 100.0*(r.samples_per_s/b.samples_per_s - 1.0);
+      if(change < -tolerance) {
+        std::cerr <<"REGRESSION: " <<r.name <<' ' <<r.rate <<" Hz, " <<r.channels <<" channels: " <<std::fixed
+                  <<std::setprecision(1) <<change <<"% (" <<std::setprecision(0) <<r.samples_per_s <<" samples/s, baseline "
+                  <<b.samples_per_s <<")\n";
+        regressions++;
+      }
+    }
+
+  return regressions;
+}
+
+
+
+int main(int argc, char** argv)
+{
+  const int minutes = (argc > 1) ? atoi(argv[1]) : 10;
+  const char* baseline = ((argc > 2) && strcmp(argv[2], "-")) ? argv[2] : NULL;
+  const double tolerance = (argc > 3) ? atof(argv[3]) : 15.0;
+  const int rates[] = {8000, 16000, 44100, 48000};
+  std::vector<Cresult> results, reference;
+  char dir[] = "/tmp/srcclock_benchXXXXXX";
+
+  if((minutes <= 0) || (tolerance < 0.0)) {
+    std::cerr <<"Usage: " <<argv[0] <<" [MINUTES [BASELINE [TOLERANCE]]]\n";
+    return 1;
+  }
+  if(!mkdtemp(dir)) {
+    std::cerr <<"EE: Unable to create the directory of the test files\n";
+    return 1;
+  }
+  tmpdir = dir;
+
+  for(int r : rates) {
+    const double seconds = 60.0*minutes;
+
+    std::cerr <<"Benchmarks at " <<r <<" Hz\n";
+    results.push_back({"goertzel", r, 1, goertzel(r, seconds, false)});
+    results.push_back({"goertzel_s16", r, 1, goertzel(r, seconds, true)});
+    if(r > FC) results.push_back({"resample", r, 1, resample(r, seconds)});
+
+    for(int ch = 1; ch <= 2; ch++) {
+      results.push_back({"play", r, ch, play(r, ch, minutes)});
+      results.push_back({"corpus", r, ch, corpus(r, ch, minutes)});
+      results.push_back({"read", r, ch, read(r, ch)});
+      results.push_back({"decode", r, ch, decode(r, ch, minutes)});
+      unlink(file_name(r, ch).c_str());
+    }
+  }
+  rmdir(dir);
+
+  print(std::cout, results);
+
+  if(baseline) {
+    if(!load(baseline, reference)) {
+      std::cerr <<"WW: Unable to read the baseline " <<baseline <<'\n';
+      return 0;
+    }
+    const int regressions = compare(results, reference, tolerance);
+    std::cerr <<regressions <<" regressions over " <<tolerance <<"% against " <<baseline <<'\n';
+    if(regressions > 0) return 2;
+  }
+
+  return 0;
+}
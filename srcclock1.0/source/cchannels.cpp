@@ -0,0 +1,219 @@
+/*
+    Class Cchannels - Implementation.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "cchannels.h"
+#include "csrc.h"
+
+
+#define BLOCK_TIME	0.1	// seconds of the stream read at once
+
+
+
+Cchannels::Cchannels(Csrc& s)
+: stream(s)
+{
+  channels = stream.soundChannels;
+  if(channels > MAX_CHANNELS) channels = MAX_CHANNELS;
+  if(channels < 1) channels = 1;
+
+  block = int(BLOCK_TIME*stream.stream_frequency);
+  iso = false;
+  r = 0;
+  generation = 0;
+  pending = 0;
+  quit = false;
+
+  src = std::vector<Csrc>(channels);
+  decoder.assign(channels, NULL);
+  resampler.resize(channels);
+  found.resize(channels);
+  frames.resize(block*stream.soundChannels);
+  input.resize(channels, std::vector<float>(block));
+  output.resize(channels);
+}
+
+Cchannels::~Cchannels()
+{
+  for(int k = 0; k < channels; k++) delete decoder[k];
+}
+
+
+
+int Cchannels::decode()
+{
+  const bool decimate = (stream.stream_frequency != stream.sample_frequency);
+  bool done = false;
+  int decoded = 0;
+
+  if(!stream.streamON) {
+    stream.error = -2;
+    return 0;
+  }
+  stream.reset_reads();
+
+  for(int k = 0; k < channels; k++) {
+    src[k] = stream;
+    src[k].soundChannels = 1;
+    src[k].verbose_level = 0;		// the threads would mix their logs
+    src[k].late_samples = 0;
+    src[k].resampler_lag = 0.0;
+
+    if(decimate) {
+      resampler[k].set(stream.stream_frequency, stream.sample_frequency);
+      output[k].resize(block + 1);		// decimating, a block gives at most one output for each input
+    }
+    else output[k].clear();
+
+    found[k].frame = found[k].sync = -1;
+    found[k].fraction = 0.0;
+    found[k].ticks.clear();
+    found[k].date.clear();
+
+    delete decoder[k];
+    decoder[k] = new Cdecoder(src[k]);
+  }
+
+  if(stream.verbose_level >= 2) stream.lout <<"Decoding " <<channels <<" channels independently\n";
+
+  generation = 0;
+  pending = 0;
+  quit = false;
+  for(int k = 0; k < channels; k++) pool.push_back(std::thread(&Cchannels::work, this, k));
+
+  stream.running = true;
+
+  while(stream.running && !done) {
+    r = stream.readFrames(&frames[0], block);
+    if(r < 0) {	// error in the input stream
+      stream.running = false;
+      stream.error = -3;
+      if(stream.verbose_level >= 1) stream.lerr <<"EE: Reading error!!\n";
+      break;
+    }
+
+    for(int k = 0; k < channels; k++) {	// the decoders time the events of this block on its stamps
+      src[k].sys_clock = stream.sys_clock;
+      src[k].block = stream.block;
+      src[k].latency = stream.latency;
+    }
+
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      pending = channels;
+      generation++;
+      start_cv.notify_all();
+      done_cv.wait(lock, [this]() { return pending == 0; });
+    }
+
+    done = true;
+    for(int k = 0; k < channels; k++) {
+      collect(k);
+      done = done && decoder[k]->done();
+    }
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    quit = true;
+    start_cv.notify_all();
+  }
+  for(int k = 0; k < channels; k++) pool[k].join();
+  pool.clear();
+
+  for(int k = 0; k < channels; k++) {
+    if(!decoder[k]->done()) src[k].decoded = false;	// interrupted
+    if(src[k].decoded) {
+      found[k].date = src[k].dateSTR(iso);
+      decoded++;
+    }
+  }
+
+  stream.running = false;
+  stream.log_reads();
+
+  return decoded;
+}
+
+
+
+void Cchannels::work(int k)
+{
+  long long last = 0;		// last block processed
+  std::unique_lock<std::mutex> lock(mutex);
+
+  while(true) {
+    start_cv.wait(lock, [&]() { return quit || (generation != last); });
+    if(quit) return;
+    last = generation;
+
+    lock.unlock();
+    process(k);
+    lock.lock();
+
+    if(--pending == 0) done_cv.notify_one();
+  }
+}
+
+
+
+void Cchannels::process(int k)
+{
+  const int ch = stream.soundChannels;
+  float* x = &input[k][0];
+  int n = block;		// at the end of the stream the missing samples are zeros
+
+  if(decoder[k]->done()) return;
+
+  for(int i = 0; i < block; i++) x[i] = frames[i*ch + k];
+
+  if(!output[k].empty()) {
+    n = resampler[k].process(x, block, &output[k][0]);
+    src[k].resampler_lag = resampler[k].lag()/stream.stream_frequency;
+    x = &output[k][0];
+  }
+
+  src[k].stats.block();		// the channel is not read by src[k]: the block is the feed
+  decoder[k]->feed(x, n);
+}
+
+
+
+void Cchannels::collect(int k)
+{
+  Cevent e;
+
+  while(decoder[k]->event(e)) {
+    switch(e.type) {
+      case EVENT_FRAME:	found[k].frame = e.sample;
+			src[k].late_samples = decoder[k]->position() - e.sample;	// samples read after the reference of the timing
+			if(stream.verbose_level >= 1) stream.lout <<"Channel " <<(k+1) <<": frame decoded at sample " <<e.sample <<'\n';
+			break;
+      case EVENT_TICK:	found[k].ticks.push_back(e.sample);
+			break;
+      case EVENT_SYNC:	found[k].sync = e.sample;
+			found[k].fraction = e.fraction;
+			src[k].late_samples = decoder[k]->position() - e.sample;
+			if(stream.verbose_level >= 1) stream.lout <<"Channel " <<(k+1) <<": syncronised at sample " <<e.sample <<'\n';
+			break;
+      case EVENT_TIMEOUT:	if(stream.verbose_level >= 1) stream.lerr <<"Channel " <<(k+1) <<": timeout at sample " <<e.sample <<'\n';
+			break;
+      default:		break;
+    }
+  }
+}
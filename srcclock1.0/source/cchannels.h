@@ -0,0 +1,106 @@
+/*
+    Class Cchannels - Part of the SRCclock program.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CCHANNELS_H
+#define CCHANNELS_H
+
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "cresampler.h"
+#include "cscanner.h"
+
+
+#define MAX_CHANNELS	8	// channels of the input stream decoded independently
+
+
+class Csrc;
+class Cdecoder;
+
+
+
+/**
+ * @brief Decode each channel of a multi-channel input stream independently.
+ *
+ * The frames read from the stream are not averaged: they are deinterleaved and each channel is fed to its own Cdecoder,
+ * so that different receivers (e.g. two tuners on the left and right inputs of one sound card) are decoded by a single
+ * stream. Each channel works on a copy of the settings of the stream, which then holds the date, the state and the
+ * timing of that channel (see channel()). The stream is read by the calling thread and the decoders of the channels
+ * process each block in parallel, one thread for each channel.
+ *
+ * @class Cchannels
+ * @author Vittorio Tornielli di Crestvolant   <vittorio.tornielli@gmail.com>
+ * @version 1.0
+ * @date 2009-2014
+ */
+
+class Cchannels {
+    Csrc& stream;		// input stream and decoding settings
+    int channels;
+    int block;			// frames read at once
+    bool iso;			// date in the format ISO 8601
+    std::vector<Csrc> src;	// settings, date and timing of each channel
+    std::vector<Cdecoder*> decoder;
+    std::vector<Cresampler> resampler;	// decimation of each channel
+    std::vector<Cminute> found;	// frame and syncronisation of each channel
+    std::vector<float> frames;	// interleaved frames of the last block
+    std::vector<std::vector<float> > input, output;	// samples of each channel before and after the decimation
+    int r;			// frames of the last block
+
+    std::vector<std::thread> pool;
+    std::mutex mutex;
+    std::condition_variable start_cv, done_cv;
+    long long generation;	// blocks given to the threads
+    int pending;		// channels still processing the last block
+    bool quit;
+
+public:
+    Cchannels(Csrc& s);		/**< Decoders for each channel of the input stream of s, opened with up to MAX_CHANNELS channels */
+    ~Cchannels();
+
+
+    /**
+     * @brief Decode all the channels until each one has been decoded (and syncronised) or has timed out
+     *
+     * @return int number of channels decoded
+     */
+    int decode();
+
+    int size() const { return channels; }	/**< Return the number of channels */
+    const Csrc& channel(int k) const { return src[k]; }	/**< Return the state (OK(), sincronized()), the date and the timing (microsecDelay()) of the channel k */
+
+    /**
+     * @brief Return the frame and the syncronisation of the channel k
+     *
+     * The sample indexes count the samples of the channel since the beginning of decode(), after the decimation if any.
+     * They are -1 if not received.
+     */
+    const Cminute& minute(int k) const { return found[k]; }
+
+    void set_iso(bool iso8601) { iso = iso8601; }		/**< Dates in the format ISO 8601 instead of RFC 2822 */
+
+private:
+    void work(int k);		// thread of the channel k
+    void process(int k);	// deinterleaves and decodes the last block on the channel k
+    void collect(int k);	// events of the channel k
+};
+
+#endif // CCHANNELS_H
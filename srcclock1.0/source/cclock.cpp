@@ -0,0 +1,156 @@
+/*
+    Class Cclock - Implementation.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cmath>
+#include <ctime>
+#include <sys/timex.h>
+#include "cclock.h"
+
+
+#define FREQ_SCALE	65536e6		// units of timex.freq for 1 s/s (ppm with 16 bit fraction)
+#define MAX_FREQ	500e-6		// limit of timex.freq
+#define MAX_SLEW	0.5		// limit of timex.offset for ADJ_OFFSET_SINGLESHOT (s)
+#define SLEW_RATE	500e-6		// rate of the slew of ADJ_OFFSET_SINGLESHOT (s/s)
+
+
+
+Csysclock::Csysclock()
+{
+  struct timex t = timex();
+
+  freq = 0.0;
+  pll = 0;
+  if(adjtimex(&t) < 0) return;
+
+  freq = t.freq/FREQ_SCALE;
+  if(t.status & (STA_PLL | STA_FLL)) {		// the kernel PLL would fight with the servo
+    const int on = t.status & (STA_PLL | STA_FLL);
+
+    t.modes = ADJ_STATUS;
+    t.status &= ~(STA_PLL | STA_FLL);
+    if(adjtimex(&t) >= 0) pll = on;
+  }
+}
+
+
+// the discipline of the kernel is given back as it was found
+Csysclock::~Csysclock()
+{
+  struct timex t = timex();
+
+  if(!pll || (adjtimex(&t) < 0)) return;
+
+  t.modes = ADJ_STATUS;
+  t.status |= pll;
+  adjtimex(&t);
+}
+
+
+double Csysclock::offset(double reference)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_REALTIME, &now);
+
+  return reference - (now.tv_sec + now.tv_nsec*1e-9);
+}
+
+
+bool Csysclock::step(double offset)
+{
+  struct timespec now;
+  long long ns;
+
+  if(clock_gettime(CLOCK_REALTIME, &now) < 0) return false;
+
+  ns = now.tv_nsec + llround(offset*1e9);
+  now.tv_sec += ns/1000000000;
+  ns %= 1000000000;
+  if(ns < 0) {
+    ns += 1000000000;
+    now.tv_sec--;
+  }
+  now.tv_nsec = ns;
+
+  return clock_settime(CLOCK_REALTIME, &now) == 0;
+}
+
+
+bool Csysclock::slew(double phase, double frequency)
+{
+  struct timex t = timex();
+
+  if(frequency > MAX_FREQ) frequency = MAX_FREQ;
+  if(frequency < -MAX_FREQ) frequency = -MAX_FREQ;
+  if(phase > MAX_SLEW) phase = MAX_SLEW;
+  if(phase < -MAX_SLEW) phase = -MAX_SLEW;
+
+  t.modes = ADJ_FREQUENCY;
+  t.freq = lround(frequency*FREQ_SCALE);
+  if(adjtimex(&t) < 0) return false;
+  freq = frequency;
+
+  t = timex();
+  t.modes = ADJ_OFFSET_SINGLESHOT;
+  t.offset = lround(phase*1e6);		// microseconds
+
+  return adjtimex(&t) >= 0;
+}
+
+
+
+Csimclock::Csimclock(double initial_offset, double frequency_error, double jitter, unsigned int seed)
+: random(seed), noise(0.0, (jitter > 0.0) ? jitter : 1e-300)
+{
+  error = -initial_offset;
+  drift = frequency_error;
+  freq = 0.0;
+  slewing = 0.0;
+  last = -1.0;
+}
+
+
+double Csimclock::offset(double reference)
+{
+  if(last >= 0.0) {
+    const double max = SLEW_RATE*(reference - last);
+    const double slewed = (slewing > max) ? max : ((slewing < -max) ? -max : slewing);
+
+    error += (drift + freq)*(reference - last) + slewed;
+    slewing -= slewed;
+  }
+  last = reference;
+
+  return -error + noise(random);
+}
+
+
+bool Csimclock::step(double offset)
+{
+  error += offset;
+  return true;
+}
+
+
+bool Csimclock::slew(double phase, double frequency)
+{
+  slewing = phase;		// as ADJ_OFFSET_SINGLESHOT, the slew still running is dropped
+  freq = frequency;
+  return true;
+}
@@ -0,0 +1,126 @@
+/*
+    Class Cclock - Part of the SRCclock program.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CCLOCK_H
+#define CCLOCK_H
+
+
+#include <random>
+
+
+
+/**
+ * @brief Clock disciplined by Cservo.
+ *
+ * The reference time is given in seconds since the epoch, as a double (resolution better than 1 us). The offset is the
+ * reference time minus the time of the clock at the same instant; the frequency correction is in s/s (1e-6 = 1 ppm),
+ * positive to make the clock faster.
+ *
+ * @class Cclock
+ * @author Vittorio Tornielli di Crestvolant   <vittorio.tornielli@gmail.com>
+ * @version 1.0
+ * @date 2009-2014
+ */
+
+class Cclock {
+public:
+    virtual ~Cclock() {}
+
+    virtual double offset(double reference) = 0;	/**< Return the offset of the clock from the reference time, read now */
+    virtual bool step(double offset) = 0;		/**< Step the clock by offset seconds. Returns false on errors */
+    virtual bool slew(double phase, double frequency) = 0;	/**< Slew the clock by phase seconds and set its frequency correction. Returns false on errors */
+    virtual double frequency() const = 0;		/**< Return the frequency correction applied to the clock */
+};
+
+
+
+/**
+ * @brief The system clock (CLOCK_REALTIME), steered through adjtimex().
+ *
+ * The frequency correction is set with ADJ_FREQUENCY and the phase is slewed with ADJ_OFFSET_SINGLESHOT, the
+ * correction of adjtime() (500 ppm at most, so 30 ms in a minute). The kernel PLL/FLL is switched off at the creation,
+ * as the servo is ours, and switched on again at the destruction if it was on; the frequency correction already set in
+ * the kernel is kept. Steps use clock_settime(). All
+ * need the capability CAP_SYS_TIME.
+ *
+ * @class Csysclock
+ * @author Vittorio Tornielli di Crestvolant   <vittorio.tornielli@gmail.com>
+ * @version 1.0
+ * @date 2009-2014
+ */
+
+class Csysclock : public Cclock {
+    double freq;		// frequency correction of the kernel
+    int pll;			// STA_PLL and STA_FLL bits of the kernel status switched off at the creation
+
+public:
+    Csysclock();
+    ~Csysclock();
+
+    double offset(double reference);
+    bool step(double offset);
+    bool slew(double phase, double frequency);
+    double frequency() const { return freq; }
+};
+
+
+
+/**
+ * @brief Simulated clock, to test the servo without touching the system clock.
+ *
+ * The clock has its own error: an initial offset and a frequency error, plus a Gaussian noise on each reading (the
+ * jitter of the measure). It keeps no time of its own: its time is the reference time plus its error, which grows with
+ * the reference time elapsed between two readings. The phase is slewed at 500 us/s, as adjtime(), and a new slew replaces
+ * the one still running.
+ *
+ * @class Csimclock
+ * @author Vittorio Tornielli di Crestvolant   <vittorio.tornielli@gmail.com>
+ * @version 1.0
+ * @date 2009-2014
+ */
+
+class Csimclock : public Cclock {
+    double error;		// time of the clock minus reference time, at the last reading
+    double drift;		// frequency error of the clock
+    double freq;		// frequency correction
+    double slewing;		// phase still to be slewed
+    double last;		// reference time of the last reading. Negative before the first one
+    std::mt19937 random;
+    std::normal_distribution<double> noise;
+
+public:
+    /**
+     * @brief Simulated clock
+     *
+     * @param initial_offset Offset of the clock at the first reading
+     * @param frequency_error Frequency error of the clock (s/s)
+     * @param jitter Standard deviation of the noise of the readings
+     * @param seed Seed of the noise
+     */
+    Csimclock(double initial_offset, double frequency_error, double jitter = 0.0, unsigned int seed = 1);
+
+    double offset(double reference);
+    bool step(double offset);
+    bool slew(double phase, double frequency);
+    double frequency() const { return freq; }
+
+    double true_offset() const { return -error; }	/**< Return the offset of the clock at the last reading, without noise */
+};
+
+#endif // CCLOCK_H
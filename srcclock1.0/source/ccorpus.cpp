@@ -0,0 +1,380 @@
+/*
+    Class Ccorpus - Implementation.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <chrono>
+#include <iomanip>
+#include "ccorpus.h"
+#include "csrc.h"
+
+
+#define TICK		0.1	// seconds of a RP
+#define FRAME_START	52	// second of the first bit of the frame
+#define FIRST_RP	54	// second of the first RP
+#define BLOCK		32	// samples of a tone with the same fading gain and the same phasor anchor
+
+
+
+Ccorpus::Ccorpus(Csrc& s)
+: src(s)
+{
+  impairments.offset = 0.0;
+  impairments.phase = 0.0;
+  impairments.drift = 0.0;
+  impairments.fade_depth = 0.0;
+  impairments.fade_period = 10.0;
+  impairments.program_level = -20.0;
+  amplitude = pow(10, -6.0/20.0);
+  noise = 0.0;
+  seed = 0;
+  seeded = false;
+  iso = false;
+  leap = 0;
+  labels = NULL;
+  memory = NULL;
+  fs = 0.0;
+  elapsed = 0.0;
+}
+
+
+void Ccorpus::set_power(double power)
+{
+  if(power > 0) power *= -1;
+  amplitude = pow(10, power/20.0);
+}
+
+
+
+bool Ccorpus::set_impairments(const char* spec)
+{
+  Cimpairments i;
+  std::string list(spec ? spec : "");
+  size_t pos = 0;
+
+  i.offset = i.phase = i.drift = i.fade_depth = 0.0;
+  i.fade_period = 10.0;
+  i.program_level = -20.0;
+
+  while(pos < list.size()) {
+    size_t end = list.find(',', pos);
+    if(end == std::string::npos) end = list.size();
+
+    const std::string item = list.substr(pos, end - pos);
+    const size_t eq = item.find('=');
+    if(eq == std::string::npos) return false;
+
+    const std::string key = item.substr(0, eq);
+    const std::string value = item.substr(eq + 1);
+    const char* v = value.c_str();
+    char* next;
+
+    if(key == "snr") {
+      while(true) {
+        i.snr.push_back(strtod(v, &next));
+        if(next == v) return false;
+        if(*next == '\0') break;
+        if(*next != ':') return false;
+        v = next + 1;
+      }
+    }
+    else if((key == "offset") || (key == "phase") || (key == "drift")) {
+      ((key == "offset") ? i.offset : (key == "phase") ? i.phase : i.drift) = strtod(v, &next);
+      if((next == v) || (*next != '\0')) return false;
+    }
+    else if(key == "fade") {
+      i.fade_depth = fabs(strtod(v, &next));
+      if((next == v) || ((*next != '\0') && (*next != ':'))) return false;
+      if(*next == ':') {
+        v = next + 1;
+        i.fade_period = strtod(v, &next);
+        if((next == v) || (*next != '\0') || (i.fade_period <= 0.0)) return false;
+      }
+    }
+    else if(key == "program") {	// the name of the file may contain ':', the level is after the last one
+      const size_t colon = value.rfind(':');
+      i.program = value;
+      if(colon != std::string::npos) {
+        v = value.c_str() + colon + 1;
+        const double level = strtod(v, &next);
+        if((next != v) && (*next == '\0')) {
+          i.program = value.substr(0, colon);
+          i.program_level = level;
+        }
+      }
+      if(i.program.empty()) return false;
+    }
+    else return false;
+
+    pos = end + 1;
+  }
+
+  return set_impairments(i);
+}
+
+
+bool Ccorpus::set_impairments(const Cimpairments& i)
+{
+  impairments = i;
+  return load_program();
+}
+
+
+// the program audio is read in the format of the output stream
+bool Ccorpus::load_program()
+{
+  program.clear();
+  if(impairments.program.empty()) return true;
+
+  std::ifstream in(impairments.program.c_str(), std::ios::binary);
+  const float gain = pow(10, impairments.program_level/20.0);
+
+  if(!in) return false;
+
+  if(src.stream_format == PA_SAMPLE_S16LE) {
+    int16_t q;
+    while(in.read(reinterpret_cast<char*>(&q), sizeof(q))) program.push_back(gain*q/32768.0f);
+  }
+  else {
+    float x;
+    while(in.read(reinterpret_cast<char*>(&x), sizeof(x))) program.push_back(gain*x);
+  }
+
+  return !program.empty();
+}
+
+
+
+long long Ccorpus::generate(int minutes, int threads)
+{
+  std::vector<Cminute_plan> batch;
+  std::vector<std::vector<float> > signal;
+  std::vector<float> frames;
+  std::vector<std::thread> pool;
+  const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  long long written = 0;
+
+  if(!memory && !src.streamON) {
+    src.error = -2;
+    return -1;
+  }
+
+  if(threads <= 0) threads = std::thread::hardware_concurrency();
+  if(threads <= 0) threads = 1;
+  if(threads > minutes) threads = (minutes > 0) ? minutes : 1;
+
+  if(!seeded) seed = Crandom::device_seed();
+  fs = src.sample_frequency*(1.0 + impairments.drift*1e-6);
+  elapsed = 0.0;
+  src.sec = 0;
+  src.dst = summer_time();
+  src.running = true;
+
+  if(src.verbose_level >= 1)
+    src.lout <<"Corpus: " <<minutes <<" minutes from " <<src.dateSTR(iso) <<"; " <<threads <<" threads; seed " <<(long long)seed <<'\n';
+
+  batch.resize(threads);
+  signal.resize(threads);
+
+  for(int k = 0; (k < minutes) && src.running; k += threads) {
+    const int n = std::min(threads, minutes - k);
+
+    for(int j = 0; j < n; j++) plan(batch[j], k + j, k + j == minutes - 1);	// the dates follow one another
+
+    pool.clear();
+    for(int j = 1; j < n; j++) pool.push_back(std::thread(&Ccorpus::render, this, std::cref(batch[j]), k + j, std::ref(signal[j])));
+    render(batch[0], k, signal[0]);
+    for(unsigned int j = 0; j < pool.size(); j++) pool[j].join();
+
+    for(int j = 0; j < n; j++) {
+      const Cminute_plan& m = batch[j];
+      const int size = signal[j].size();
+
+      Csynth::clip(signal[j].data(), size);
+      if(memory) memory->insert(memory->end(), signal[j].begin(), signal[j].end());
+      else {
+        frames.resize(size*src.soundChannels);
+        Csynth::interleave(signal[j].data(), size, src.soundChannels, frames.data());
+        src.writeBuffer(frames.data(), size);
+      }
+      written += size;
+
+      if(labels)
+        *labels <<std::fixed <<std::setprecision(3) <<fs*(m.start + FRAME_START) <<'\t' <<fs*(m.start + m.length) <<'\t'
+                <<m.date <<'\t' <<std::setprecision(1) <<m.snr <<'\n';
+      if(src.verbose_level >= 2)
+        src.lout <<"Minute " <<(k + j) <<": " <<m.date <<"; " <<m.ticks <<" RP; SNR " <<m.snr <<" dB; samples " <<m.first <<" - " <<m.last <<'\n';
+    }
+  }
+
+  src.running = false;
+  src.error = 0;
+
+  if(src.verbose_level >= 1) {
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    const double signal_time = written/fs;
+
+    src.lout <<"Corpus: " <<written <<" samples (" <<signal_time/3600.0 <<" hours of signal) in " <<seconds <<" s, "
+             <<signal_time/seconds <<" times faster than real time\n";
+  }
+
+  return written;
+}
+
+
+
+void Ccorpus::plan(Cminute_plan& m, int k, bool end)
+{
+  warnings();
+  src.encode();
+  for(int i = 0; i < 48; i++) m.bits[i] = src.src_vector[i];
+
+  m.ticks = src.number_of_RP();
+  m.length = 60 + m.ticks - 6;
+  m.start = elapsed;
+  m.first = (long long)ceil(fs*m.start);
+  m.last = (long long)ceil(fs*(m.start + m.length + (end ? 1 : 0)));	// the corpus ends with the second 0 of the last date
+  elapsed += m.length;
+
+  if(impairments.snr.empty()) {
+    m.snr = (noise > 0.0) ? 10*log10(amplitude*amplitude/2.0/(noise*noise)) : INFINITY;
+    m.sigma = noise;
+  }
+  else {
+    m.snr = impairments.snr[k % impairments.snr.size()];
+    m.sigma = amplitude*sqrt(0.5/pow(10, m.snr/10.0));
+  }
+
+  if(m.ticks != 6) leap = 0;		// the leap second has been inserted
+  src.add_minute();
+  m.date = src.dateSTR(iso);
+}
+
+
+
+/* The minute starts with the RP of its second 0 (the last one of the previous minute), then the frame and the RP of the
+   seconds 54 - 58; with a positive leap second there is one more RP at the second 60, with a negative one the RP of
+   the second 58 is missing. The last minute of the corpus ends with the RP of the following second 0, so it can be
+   syncronised as well.
+*/
+void Ccorpus::render(const Cminute_plan& m, int k, std::vector<float>& x) const
+{
+  const int ticks = std::min(5, m.ticks - 1);
+  Crandom random(seed + k);
+
+  x.assign(m.last - m.first, 0.0f);
+
+  tone(m, x, 0.0, TICK, src.Fsync);
+  for(int i = 0; i < 48; i++)
+    tone(m, x, FRAME_START + i*src.Ts + ((i >= 32) ? 0.04 : 0.0), src.Ts, m.bits[i] ? src.F1 : src.F0);
+  for(int i = 0; i < ticks; i++) tone(m, x, FIRST_RP + i, TICK, src.Fsync);
+  if(m.ticks == 7) tone(m, x, 60.0, TICK, src.Fsync);
+  tone(m, x, m.length, TICK, src.Fsync);		// only in the last minute, the following ones start with it
+
+  if(m.sigma > 0.0) random.add(x.data(), x.size(), m.sigma);
+
+  if(!program.empty()) {
+    const long long size = program.size();
+    long long p = m.first % size;
+
+    for(unsigned int i = 0; i < x.size(); i++) {
+      x[i] += program[p];
+      if(++p == size) p = 0;
+    }
+  }
+}
+
+
+/* Tone of freq (shifted by the frequency offset, starting at the phase of the impairments) from the time t of the minute, for duration seconds. The sample n of
+   the corpus is at the true time n/fs. The phasor is computed again every BLOCK samples, where the gain of the fading
+   is updated as well.
+*/
+void Ccorpus::tone(const Cminute_plan& m, std::vector<float>& x, double t, double duration, int freq) const
+{
+  const double f = freq + impairments.offset;
+  const double theta = impairments.phase/180.0*M_PI;
+  const double w = 2*M_PI*f/fs;
+  const double start = m.start + t;
+  const long long first = std::max((long long)ceil(fs*start), m.first);
+  const long long last = std::min((long long)ceil(fs*(start + duration)), m.last);
+  const double cw = cos(w), sw = sin(w);
+
+  for(long long n = first; n < last; n += BLOCK) {
+    const long long end = std::min(n + BLOCK, last);
+    const double phase = theta + 2*M_PI*f*(n/fs - start);
+    double re = cos(phase), im = sin(phase), a = amplitude;
+
+    if(impairments.fade_depth > 0.0)
+      a *= pow(10, -impairments.fade_depth/20.0*(1.0 - cos(2*M_PI*(n/fs)/impairments.fade_period))/2.0);
+
+    float* y = &x[n - m.first];
+    for(long long i = n; i < end; i++) {
+      const double r = re*cw - im*sw;
+
+      *y++ += a*re;
+      im = re*sw + im*cw;
+      re = r;
+    }
+  }
+}
+
+
+
+/* Warning of change of time of the European Union: the summer time starts at 2:00 CET of the last Sunday of March and
+   ends at 3:00 CEST of the last Sunday of October. SE counts the days to the change, 0 on the day of the change.
+*/
+void Ccorpus::warnings()
+{
+  const int month = src.dst ? 10 : 3;
+  int se = 7;
+
+  if(src.month == month) {
+    const int days = last_sunday(src.year, month) - src.day;
+    if((days >= 0) && (days <= 6)) se = days;
+  }
+
+  src.change_time = se;
+  src.leap_second = leap;
+}
+
+
+bool Ccorpus::summer_time() const
+{
+  if((src.month < 3) || (src.month > 10)) return false;
+  if((src.month > 3) && (src.month < 10)) return true;
+
+  const int sunday = last_sunday(src.year, src.month);
+  if(src.month == 3) return (src.day > sunday) || ((src.day == sunday) && (src.hour >= 3));
+  return (src.day < sunday) || ((src.day == sunday) && (src.hour < 3));	// the hour 2 of the change is taken as CEST
+}
+
+
+int Ccorpus::last_sunday(int year, int month)
+{
+  static const int offset[] = {0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4};
+  static const int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  const int last = days[month - 1] + (((month == 2) && Csrc::leapyear(year)) ? 1 : 0);
+  const int y = year - (month < 3);
+  const int wday = (y + y/4 - y/100 + y/400 + offset[month - 1] + last) % 7;	// day of the week of the last day, 0 = Sunday
+
+  return last - wday;
+}
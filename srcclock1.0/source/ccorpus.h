@@ -0,0 +1,145 @@
+/*
+    Class Ccorpus - Part of the SRCclock program.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CCORPUS_H
+#define CCORPUS_H
+
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <ostream>
+
+
+class Csrc;
+
+
+
+/**
+ * @brief Impairments of the channel applied by Ccorpus
+ */
+struct Cimpairments {
+  std::vector<double> snr;	/**< SNR in dB of each minute (tone power over noise power in the whole band), repeated cyclically. Empty = noise of play() */
+  double offset;		/**< Frequency offset of the tones in Hz */
+  double phase;			/**< Phase of the tones at their start in degrees, as the random theta of play() */
+  double drift;			/**< Error of the sampling clock of the receiver in ppm (positive = faster) */
+  double fade_depth;		/**< Depth of the fading in dB. 0 = no fading */
+  double fade_period;		/**< Period of the fading in seconds */
+  std::string program;		/**< File of program audio added to the signal (mono, at the sampling frequency and in the format of the output), looped */
+  double program_level;		/**< Gain of the program audio in dB */
+};
+
+
+
+/**
+ * @brief Synthetic corpus of SRC minutes: hours of continuous signal with the impairments of a real channel, rendered
+ *        on many threads faster than real time, with the labels of every minute.
+ *
+ * The corpus starts at the second 0 of the date of the Csrc object and goes on minute after minute with add_minute().
+ * The flag of the summer time and its warning (SE, days before the change) follow the calendar of the European Union
+ * (last Sundays of March and October); the leap second given with the warning SI is inserted (or removed) at the
+ * first end of month, and that minute lasts 61 (or 59) seconds. Every minute has the RP of its second 0, the frame at
+ * the second 52 and the RP from the second 54 to the end of the minute, as play().
+ *
+ * The minutes are described in order (date, bits, RP) and rendered in batches, one minute for each thread, from the
+ * true time of their tones: the sample n of the output is at the time n/(fs*(1 + drift)), so the drift of the sampling
+ * clock stretches the timing and the frequencies of the whole corpus, and the tones (shifted by the frequency offset)
+ * are computed with a recursive phasor from their exact start. The signal is faded, the Gaussian noise of each minute
+ * is seeded with seed + minute (so the corpus does not depend on the number of threads), the program audio is added,
+ * then the samples are clipped and written to the output stream of the Csrc object in order, or appended to a buffer
+ * in memory (e.g. to feed a Cdecoder without files).
+ *
+ * Each label is a line: the sample of the first bit of the frame, the sample of the second 0 that follows (the
+ * syncronisation), the date decoded (the one of that second 0) and the SNR of the minute in dB.
+ *
+ * @class Ccorpus
+ * @author Vittorio Tornielli di Crestvolant   <vittorio.tornielli@gmail.com>
+ * @version 1.0
+ * @date 2009-2014
+ */
+
+class Ccorpus {
+    struct Cminute_plan {
+      int bits[48];
+      int ticks;		// RP of the minute (see Csrc::number_of_RP())
+      double start;		// true time of the second 0 of the minute since the start of the corpus
+      int length;		// seconds of the minute
+      double snr;		// dB. NAN without SNR schedule
+      double sigma;		// RMS of the noise
+      long long first, last;	// samples of the minute: [first, last). The last minute has one more second
+      std::string date;		// date of the second 0 that ends the minute
+    };
+
+    Csrc& src;			// date, settings and output stream
+    Cimpairments impairments;
+    std::vector<float> program;	// program audio, scaled
+    double amplitude;		// amplitude of the tones
+    double noise;		// RMS of the noise without SNR schedule
+    uint64_t seed;
+    bool seeded;
+    bool iso;
+    int leap;			// leap second still to be inserted
+    std::ostream* labels;
+    std::vector<float>* memory;	// buffer receiving the corpus instead of the output stream
+    double fs;			// sampling frequency of the receiver in true time (with the drift)
+    double elapsed;		// true time of the start of the next minute
+
+public:
+    Ccorpus(Csrc& s);		/**< Corpus starting from the date of s, written on its output stream with its sampling frequency, channels and format */
+
+
+    /**
+     * @brief Set the impairments from a list of KEY=VALUE separated by commas:
+     *        snr=DB[:DB...], offset=HZ, phase=DEG, drift=PPM, fade=DEPTH_DB:PERIOD_S, program=FILE[:LEVEL_DB]
+     *
+     * @return bool false on syntax errors or if the program audio cannot be read
+     */
+    bool set_impairments(const char* spec);
+    bool set_impairments(const Cimpairments& i);	/**< Set the impairments. Return false if the program audio cannot be read */
+    const Cimpairments& get_impairments() const { return impairments; }
+
+    void set_power(double power);	/**< Power of the tones in dB (maximum level is 0 dB) */
+    void set_noise(double sigma) { noise = sigma; }	/**< RMS of the noise of the minutes without SNR schedule. Default 0 */
+    void set_seed(uint64_t s) { seed = s; seeded = true; }	/**< Seed of the noise: the minute k uses seed + k. Default: random */
+    void set_leap_second(int si) { leap = si; }		/**< Leap second (+1, -1) inserted at the first end of month. Default 0 */
+    void set_iso(bool iso8601) { iso = iso8601; }	/**< Dates of the labels in the format ISO 8601 instead of RFC 2822 */
+    void set_labels(std::ostream* os) { labels = os; }	/**< Stream receiving the labels. NULL = no labels */
+    void set_memory(std::vector<float>* x) { memory = x; }	/**< Append the corpus (mono) to x instead of writing it on the output stream. NULL = output stream */
+
+
+    /**
+     * @brief Generate the corpus
+     *
+     * @param minutes Number of minutes
+     * @param threads Threads rendering the minutes. 0 = one for each core
+     * @return long long samples written (frames, if stereo), -1 if the output stream is not open and there is no buffer
+     */
+    long long generate(int minutes, int threads = 0);
+
+private:
+    void plan(Cminute_plan& m, int k, bool end);	// describes the minute of the date of src, then moves to the next one
+    void render(const Cminute_plan& m, int k, std::vector<float>& x) const;
+    void tone(const Cminute_plan& m, std::vector<float>& x, double t, double duration, int freq) const;
+    void warnings();				// SE and SI of the date of src
+    bool summer_time() const;			// the date of src is in summer time (CEST)
+    bool load_program();
+    static int last_sunday(int year, int month);	// day of the last Sunday of the month
+};
+
+#endif // CCORPUS_H
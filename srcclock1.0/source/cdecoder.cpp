@@ -0,0 +1,669 @@
+/*
+    Class Cdecoder - Implementation.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cmath>
+#include <algorithm>
+#include "cdecoder.h"
+#include "csrc.h"
+#include "cmetrics.h"
+
+
+#define PIECE 4096	// samples added to the history before processing them
+#define WEAK_SYMBOLS 8	// symbols under threshold decided anyway while a prediction of the frame is available
+
+
+
+Cdecoder::Cdecoder(Csrc& s, bool s16le)
+: src(s), fc(s.sample_frequency), N(int(s.sample_frequency*s.Ts)), Nsync(int(0.1*s.sample_frequency)), s16(s16le),
+  symbol_tones(s.sample_frequency, s.F0, s.F1), sync_tone(s.sample_frequency, s.Fsync),
+  symbol_trace(s.sample_frequency, std::vector<int>{s.F0, s.F1}, N), sync_trace(s.sample_frequency, s.Fsync, Nsync),
+  detector(s.sample_frequency, s.F0, s.F1, N)
+{
+  DELTA = N;
+  GAP = int(0.04*fc);
+
+  if(s16) history16.assign(N + 2*Nsync, 0);	// the tuning looks back up to one window before the first one
+  else history.assign(N + 2*Nsync, 0.0);
+  hbase = -(long long)(N + 2*Nsync);
+  floor = 0;
+
+  start();
+}
+
+
+void Cdecoder::start()
+{
+  begin = next = position();
+  clear(begin);
+  events.clear();
+
+  c = 0;
+  weak = 0;
+  total = 0;
+  avg = 0.0;
+  tune = false;
+  noise.set(src.noise_estimator, src.window_length, src.noise_percentile);
+
+  candidates.clear();
+  detector.reset();
+  detector.set_threshold(src.frame_score);
+  detector.set_power_floor(src.decision_threshold);
+
+  src.reset_src_vector();
+  src.decoded = false;
+  src.error = -1;
+  src.fraction = 0.0;
+  if(src.track_clock && src.predicted.empty()) src.predict(true);	// cold start
+
+  stage = (src.frame_score > 0.0) ? FRAME : ACQUIRE;
+}
+
+
+
+static const int stages[] = {STAGE_ACQUIRE, STAGE_FRAME, STAGE_SYNC, STAGE_SYNC};	// stage of Cstats of each stage of the decoder
+
+
+void Cdecoder::feed(const float* x, size_t n)
+{
+  const int s = stage;		// the call is timed in the stage the samples were fed to
+  size_t k;
+
+  while(n > 0) {
+    k = (n < PIECE) ? n : PIECE;
+    if(s16)
+      for(size_t i = 0; i < k; i++) history16.push_back(int16_t(lrintf(std::max(-32768.0f, std::min(32767.0f, x[i]*32768)))));
+    else history.insert(history.end(), x, x + k);
+    advance(x, NULL, k);
+
+    x += k;
+    n -= k;
+  }
+
+  src.stats.lap(stages[s]);
+}
+
+
+void Cdecoder::feed(const int16_t* x, size_t n)
+{
+  const int s = stage;
+  size_t k;
+
+  while(n > 0) {
+    k = (n < PIECE) ? n : PIECE;
+    if(s16) history16.insert(history16.end(), x, x + k);
+    else
+      for(size_t i = 0; i < k; i++) history.push_back(x[i]*(1.0f/32768));
+    advance(NULL, x, k);
+
+    x += k;
+    n -= k;
+  }
+
+  src.stats.lap(stages[s]);
+}
+
+
+void Cdecoder::advance(const float* x, const int16_t* q, size_t k)
+{
+  if(floor > position() - (long long)k) clear(floor);	// the samples skipped by the decoder are zeros
+  if(stage == FRAME) {
+    if(x == NULL) {		// the detector works in float
+      piece.resize(k);
+      for(size_t i = 0; i < k; i++) piece[i] = q[i]*(1.0f/32768);
+      x = &piece[0];
+    }
+    detector.feed(x, k);
+  }
+  process();
+}
+
+
+bool Cdecoder::event(Cevent& e)
+{
+  if(events.empty()) return false;
+
+  e = events.front();
+  events.pop_front();
+  return true;
+}
+
+
+int Cdecoder::wanted() const
+{
+  long long n;
+
+  switch(stage) {
+    case ACQUIRE:	n = (tune ? detected + DELTA : next) + N - position();
+			break;
+    case SYNC:		n = (tune ? detected + Nsync : next) + Nsync - position();
+			break;
+    case FRAME:		return N;
+    default:		return 0;
+  }
+
+  return (n > 0) ? int(n) : 1;
+}
+
+
+bool Cdecoder::done() const
+{
+  return stage == DONE;
+}
+
+
+
+void Cdecoder::process()
+{
+  bool more = true;
+
+  while(more) {
+    switch(stage) {
+      case ACQUIRE:	more = acquire();
+			break;
+      case FRAME:	more = acquire_frame();
+			break;
+      case SYNC:	more = sync();
+			break;
+      default:		more = false;
+    }
+  }
+
+  trim();
+}
+
+
+
+/* Each window of N samples following the previous one is tested for the tones F0 and F1. The first tone of each block
+   (F0 of ID1 and F1 of ID2) is aligned by tuning(), so the next windows match the symbols. Between the two blocks
+   there are 40 ms of silence that are skipped.
+*/
+bool Cdecoder::acquire()
+{
+  const double th = src.decision_threshold;
+  double p[2];
+  int bit;
+
+  if(tune) {
+    if(position() < detected + DELTA + N) return false;
+
+    bit = pending_bit;
+    p[0] = pending[0];
+    p[1] = pending[1];
+    next = tuning(symbol_trace, bit, detected, DELTA, p[bit]) + N;
+    tune = false;
+    if(src.verbose_level >= 2) src.lout <<"Tuned @ pass: " <<total <<'\n';
+    if(bit == 0) avg = 0.0;	// reset avg in order to calculate the average of the power of the tones F0 and F1
+
+    symbol(bit, p);
+    return true;
+  }
+
+  if(((total*N)/fc) >= src.timeout) {
+    expire(0);
+    return false;
+  }
+  if(position() < next + N) return false;
+
+  power(symbol_tones, next, N, p);	// F0 and F1 are calculated in a single pass
+  next += N;
+
+
+  //---------------------------------------------------------------- Window Calibration System
+  if(src.window_length > 0) {	// WDS is on
+    noise.add((p[0] + p[1])/2.0);
+    if(((total / src.window_length) != 0) && (c == 0)) {
+      double level = noise.estimate();	// noise level in the last symbols time
+
+      src.decision_threshold = level*src.snr_level;
+      if(src.decision_threshold > 1)
+        src.decision_threshold = std::max(level, 1.0/src.snr_level);
+      if(src.verbose_level >= 4)
+        src.lout <<"Threshold now is " <<src.get_decision_threshold() <<" dB. Noise " <<noise.name() <<" of the last " <<src.window_length
+                 <<" time symbols is " <<10*log10(level) <<" dB; Pass: " <<total <<'\n';
+    }
+  }	//------------------------------------------------------------ End of Window Calibration System
+
+
+  if(src.verbose_level >= 5)
+    src.lout <<"[DEBUG] Pass " <<total <<" Power : " <<10*log10(p[0]) <<" dB; Power2 : " <<10*log10(p[1]) <<" dB\n";
+
+  if((p[0] > th) || (p[1] > th)) {	// checks wheter one of the two frequencies has reached the threshold
+    bit = (p[0] > p[1]) ? 0 : 1;
+    if(((c == 0) || (c == 32)) && (src.verbose_level >= 2)) {
+      src.lout <<"Supposed detection at pass " <<total <<". Power level: " <<10*log10(std::max(p[0], p[1])) <<" dB for frequency "
+               <<(bit ? "F1\n" : "F0\n")
+               <<"Decision Threshold: " <<src.get_decision_threshold() <<" dB\n";
+    }
+
+    if(((bit == 0) && (c == 0)) || ((bit == 1) && (c == 32))) {	// syncronization of the block: DELTA more samples are needed
+      tune = true;
+      detected = next - N;
+      pending_bit = bit;
+      pending[0] = p[0];
+      pending[1] = p[1];
+      return true;
+    }
+
+    symbol(bit, p);
+  }
+  else if((c != 0) && (c != 32) && soft_decision()) {	// decided by the soft bit and left to the correction or to the prediction of the frame
+    weak++;
+    symbol((p[1] > p[0]) ? 1 : 0, p);
+  }
+  else if(c != 0) {		// if the symbol is under threshold during the transmission forces a reset
+    src.src_vector[c] = -1;
+    emit(EVENT_SYMBOL, next - N, c, -1, std::max(p[0], p[1]));
+    c++;
+    end_of_pass();
+  }
+  else end_of_pass();
+
+  return true;
+}
+
+
+void Cdecoder::symbol(int bit, const double* p)
+{
+  const double power = std::max(p[0], p[1]);
+
+  src.src_vector[c] = bit;
+  src.soft[c] = log((p[1] + 1e-30)/(p[0] + 1e-30));
+  if(src.verbose_level >= 3) src.lout <<'[' <<Csrc::itos(c,2) <<"] " <<bit <<" Power: " <<10*log10(power) <<" dB\n";
+  emit(EVENT_SYMBOL, next - N, c, bit, power);
+  c++;
+  avg += power;
+
+  end_of_pass();
+}
+
+
+// The symbols under threshold are decided by their soft value up to the number of bits corrected, or more while tracking
+bool Cdecoder::soft_decision() const
+{
+  if(src.confirmed) return true;	// the second block is verified by the prediction
+  if(!src.predicted.empty()) return weak < std::max(src.corrections, WEAK_SYMBOLS);
+
+  return weak < src.corrections;
+}
+
+
+void Cdecoder::end_of_pass()
+{
+  if(c == 32) src.match_prediction();	// the minute is confirmed by the first block
+
+  if(!src.check(c) && !((src.corrections > 0) && ((src.error == 2) || (src.error == 3) || (src.error == 5)))
+     && !(src.confirmed && (c > 32))) {	// the parity errors are left to the correction of the frame, the second block to the prediction
+    if(src.verbose_level >= 2) src.lout <<"EE: Detection error. RESET\nPass " <<total <<"; Error code: " <<src.error <<"\n-----\n";
+    emit(EVENT_RESET, next - N, c, src.error, 0.0);
+
+    c = 0;
+    weak = 0;
+    avg = 0.0;
+    clear(next);
+    src.reset_src_vector();
+  }
+
+  if(c == 32) {
+  /* At this point the first block has been decoded.
+     Time to skip the noise samples between the first and second block
+     and to clear the history in order to avoid wrong calculation of the power of the next tone.
+  */
+    next += GAP;
+    clear(next);
+  }
+
+  total++;	// another window has been processed!
+
+  if(c == 48) {	// all the 48 symbols have been received
+    if(src.confirmed ? src.frame_predicted() : src.frame_correct()) frame_found();
+    else {
+      if(src.verbose_level >= 2) src.lout <<"EE: decoding error after 48 symbols. Error code: " <<src.error <<"; Valid date: "
+                                          <<src.valid_date() <<"\nResetting...\n";
+      emit(EVENT_RESET, next, c, src.error, 0.0);
+      c = 0;
+      weak = 0;
+      avg = 0.0;
+      src.reset_src_vector();
+    }
+  }
+}
+
+
+
+/* Acquisition of the frame through the matched filter detector (see Cdetector). The candidates are decoded as soon as
+   the whole frame is in the history. Each symbol is decoded at its expected position, only the beginning of the second
+   block is searched again as the gap is not precise.
+*/
+bool Cdecoder::acquire_frame()
+{
+  const int SEARCH = N/8;				// uncertainty on the beginning of the second block
+  const int FRAME = 48*N + GAP + SEARCH;
+  Cdetection d;
+  double p[2];
+  long long s;
+  int second;
+
+  while(detector.detection(d)) {
+    d.sample += begin;
+    if(src.verbose_level >= 2) src.lout <<"Frame candidate at sample " <<d.sample <<"; score: " <<d.score <<'\n';
+    candidates.push_back(d);
+  }
+
+  while(!candidates.empty() && (candidates.front().sample + FRAME + SEARCH <= position())) {
+    d = candidates.front();
+    candidates.pop_front();
+    if(d.sample < hbase) continue;
+
+    s = d.sample;		// first sample of the block
+    avg = 0.0;
+    for(c = 0; c < 48; c++) {
+      if(c == 32) {		// the second block begins with the tone F1 of ID2
+        std::vector<double> f1(2*SEARCH + 1);
+
+        trace(symbol_trace, 1, s + 32*N + GAP - SEARCH, 2*SEARCH + 1, &f1[0]);
+        second = 0;
+        for(int i = 1; i <= 2*SEARCH; i++)
+          if(f1[i] > f1[second]) second = i;
+        s += GAP - SEARCH + second;
+      }
+      power(symbol_tones, s + c*N, N, p);
+      src.src_vector[c] = (p[1] > p[0]) ? 1 : 0;
+      src.soft[c] = log((p[1] + 1e-30)/(p[0] + 1e-30));
+      avg += std::max(p[0], p[1]);
+      if(src.verbose_level >= 3) src.lout <<'[' <<Csrc::itos(c,2) <<"] " <<src.src_vector[c] <<" Power: " <<10*log10(std::max(p[0], p[1])) <<" dB\n";
+      emit(EVENT_SYMBOL, s + c*N, c, src.src_vector[c], std::max(p[0], p[1]));
+    }
+
+    if(src.frame_correct() || (src.match_prediction() && src.frame_predicted())) {
+      if(src.verbose_level >= 2) src.lout <<"Frame decoded at sample " <<d.sample <<"; score: " <<d.score <<'\n';
+      next = s + 48*N;		// the syncronisation goes on from the end of the frame
+      candidates.clear();
+      frame_found();
+      return true;
+    }
+
+    if(src.verbose_level >= 2) src.lout <<"EE: decoding error of the candidate. Error code: " <<src.error <<"; Valid date: " <<src.valid_date() <<'\n';
+    emit(EVENT_RESET, d.sample, c, src.error, 0.0);
+    src.reset_src_vector();
+    c = 0;
+  }
+
+  if(((position() - begin)/fc) >= src.timeout) expire(0);
+
+  return false;
+}
+
+
+void Cdecoder::frame_found()
+{
+  emit(EVENT_FRAME, next, 48, src.corrected, avg/48);
+  if(src.tracking) src.predict(false);		// frame of the next minute
+
+  if(src.do_sync) start_sync();
+  else stage = DONE;
+}
+
+
+
+void Cdecoder::start_sync()
+{
+  if(src.verbose_level >= 1) src.lout <<"---- SRC received! Synchronization! ----\n";
+
+  clear(next);
+  c = 0;			// ticks decoded
+  total = 0;
+  tune = false;
+  noise_symbols = 5;		// 5 noise symbols to process before the sequence of RP
+  ticks = src.number_of_RP();	// determines the number of RP to expect
+
+  src.error = 7;		// SRC decoded but not syncronised
+  src.msec = 0;
+
+  if(ticks != 6) {
+    if(src.verbose_level >= 1) src.lout <<"This minute has " <<(60 + src.leap_second) <<" seconds! The sync ticks are " <<ticks <<'\n';
+    src.leap_second = 0;
+  }
+
+  if(src.adaptive_decision_threshold)
+    src.decision_threshold = std::max(src.decision_threshold, avg/(src.snr_level*48));	// updated the decision TH from the previous F0 and F1 average power
+
+  stage = SYNC;
+}
+
+
+/* The total duration of the sync timeout in seconds is the number of ticks plus 1 second between the last two RP.
+   In this calculation also the time elapsed between the end of segment S2 and the first RP is considered.
+*/
+bool Cdecoder::sync()
+{
+  double power = 0.0;
+
+  if(tune) {
+    if(position() < detected + 2*Nsync) return false;
+
+    power = pending[0];
+    next = tuning(sync_trace, 0, detected, Nsync, power) + Nsync;
+    tune = false;
+    if(src.adaptive_decision_threshold) {
+      src.decision_threshold = power/2.0;	// Sync threshold is -3 dB below the signal power
+      if(src.verbose_level >= 2) src.lout <<"Synchronization threshold: " <<src.get_decision_threshold() <<" dB\n";
+    }
+  }
+  else {
+    if(((total*Nsync)/fc) >= (ticks + 1)) {
+      expire(1);
+      return false;
+    }
+    if(position() < next + Nsync) return false;
+
+    this->power(sync_tone, next, Nsync, &power);
+    next += Nsync;
+
+    if(noise_symbols > 0) {
+      src.decision_threshold = std::max(src.decision_threshold, power*src.snr_level);
+      if(src.decision_threshold > 1)
+        src.decision_threshold = std::max(power, 1.0/src.snr_level);
+      noise_symbols--;
+    }
+
+    if(!(power > src.decision_threshold)) {
+      if(src.verbose_level >= 4) src.lout <<"Sync under threshold: " <<10*log10(power) <<" dB\n";
+      total++;
+      return true;
+    }
+
+    if(c == 0) {
+      if(src.verbose_level >= 3) src.lout <<"Supposed syncronisation RP at pass " <<total <<". TH: " <<src.get_decision_threshold() <<" dB\n";
+      tune = true;
+      detected = next - Nsync;
+      pending[0] = power;
+      return true;
+    }
+  }
+
+  c++;
+  if(src.verbose_level >= 1) {
+    if(c < ticks) src.lout <<"===== ";
+    else src.lout <<"|||||";
+    src.lout.flush();       // flush output buffer
+    if(src.verbose_level >= 3) src.lout <<"Sync tick number: " <<c <<" Power: " <<10*log10(power) <<" dB; (TH: "
+                                        <<src.get_decision_threshold() <<" dB)\n";
+  }
+  src.sec++;
+  emit(EVENT_TICK, next - Nsync, c, 0, power);
+  total++;
+
+  if(c == ticks) {
+    long long nanosec;
+    std::chrono::duration<double, std::nano> time_span = std::chrono::high_resolution_clock::now() - src.last_sample();
+
+    src.add_minute();
+    src.error = 0;
+    if(src.verbose_level >= 1) src.lout <<" =====> [Synchronized!]\n";
+    src.msec = 100;
+    // syncronisation offset in nanoseconds since the end of last RP, assuming the last sample fed is the last one read
+    nanosec = time_span.count() + (position() - next - src.fraction)*1e9/fc + src.resampler_lag*1e9;
+    if(src.verbose_level >= 2) src.lout <<"Syncronisation offset in ns: " <<nanosec <<" ns; latency of the input: " <<src.latency <<" us\n";
+    if(src.metrics) src.metrics->sync(nanosec*1e-9);
+
+    emit(EVENT_SYNC, next, c, 0, power);
+    stage = DONE;
+  }
+
+  return true;
+}
+
+
+
+void Cdecoder::expire(int at)
+{
+  if(at == 0) {
+    if(src.verbose_level >= 1) src.lerr <<"*** TIMEOUT! ***\n";
+    src.predicted.clear();	// a minute may have been missed
+    src.set_today();
+    src.error = 6;
+    src.decoded = false;
+  }
+  else {
+    src.sec = 53;		// if the system is not able to syncronize, it chooses the end of the encoded block
+    if(src.verbose_level >= 1) src.lerr <<"\nEE: Sync timeout expired. Timeout: " <<((total*Nsync)/fc) << " seconds.\n"
+                                        <<"\tTicks received: " <<c <<" out of " <<ticks <<'\n';
+    src.error = 7;
+  }
+
+  emit(EVENT_TIMEOUT, position(), c, at, 0.0);
+  stage = DONE;
+}
+
+
+void Cdecoder::emit(int type, long long sample, int index, int value, double power)
+{
+  Cevent e;
+
+  e.type = type;
+  e.sample = sample;
+  e.index = index;
+  e.value = value;
+  e.power = power;
+  e.fraction = src.fraction;
+  events.push_back(e);
+  src.stats.event(type, value);
+  if(src.metrics) src.metrics->event(type, value, power, src.decision_threshold, (noise.size() > 0) ? noise.estimate() : 0.0);
+}
+
+
+
+/* The window with the highest power of a tone of dft is searched among the ones starting in [s - delta, s + delta].
+   Returns the first sample of the window found and its power in p, and the fraction of sample to add to it in src.fraction.
+*/
+long long Cdecoder::tuning(const Csdft& dft, int tone, long long s, int delta, double& p)
+{
+  const int freq = dft.frequency(tone);
+  const long long start = s - delta;
+  const long long end = s + delta;
+  const int windows = end - start + 1;
+  const uint64_t t = src.stats.start();
+  std::vector<double> power(windows);
+  double maxpower = 0.0;
+  long long tuned = s;
+  long long i;
+  int k;
+
+  trace(dft, tone, start, windows, &power[0]);		// power of every window between start and end
+
+  for(k = 0, i = start; k < windows; k++, i++) {
+    if(src.verbose_level >= 6) src.lout <<"Power of frequency " <<freq <<" Hz, starting from sample " <<i <<" = " <<10*log10(power[k]) <<" dB\n";
+    if(maxpower < power[k]) {
+      tuned = i;
+      maxpower = power[k];
+      if(src.verbose_level >= 6) src.lout <<"Tuned!\tMax found in " <<i <<" = " <<10*log10(power[k]) <<" dB\n";
+    }
+  }
+
+  /* Refinement of the alignment: the vertex of the parabola through the power of the window found and of its two
+     neighbours. The power of the sliding window is a roof whose ridge is the alignment of the tone. Where the edge of the
+     tone falls on a zero crossing, the windows on both sides of the ridge hold the same power and the noise picks either
+     of them: the vertex falls half-way between the two. So the fraction, within half a sample, does not depend on the
+     phase of the tone as a fit on the slopes of the roof does (they follow the ripple of its image, at twice its
+     frequency). The windows can only be aligned to the integer sample, so the fraction is kept for the timing of the
+     syncronisation.
+  */
+  src.fraction = 0.0;
+  k = tuned - start;
+  if((k > 0) && (k < windows - 1)) {
+    const double curvature = power[k-1] - 2.0*power[k] + power[k+1];
+    if(curvature < 0.0) src.fraction = 0.5*(power[k-1] - power[k+1])/curvature;
+  }
+
+  if(src.verbose_level >= 3) src.lout <<"Tuning function. Tuned: " <<tuned <<" (start = " <<start <<"; end = " <<end <<"; fraction = " <<src.fraction <<")\n"
+                                      <<"MaxPower: " <<10*log10(maxpower) <<" dB\n";
+
+  p = maxpower;
+  src.stats.add(STAGE_TUNING, t);
+
+  return tuned;
+}
+
+
+void Cdecoder::power(const Cgoertzel& g, long long s, int n, double* p) const
+{
+  if(s16) g.power(&history16[s - hbase], n, p);
+  else g.power(&history[s - hbase], n, p);
+}
+
+
+void Cdecoder::trace(const Csdft& dft, int tone, long long s, int windows, double* p) const
+{
+  if(s16) dft.trace(tone, &history16[s - hbase], windows, p);
+  else dft.trace(tone, &history[s - hbase], windows, p);
+}
+
+
+void Cdecoder::clear(long long f)
+{
+  const long long e = std::min(f, position());
+
+  for(long long i = hbase; i < e; i++) {
+    if(s16) history16[i - hbase] = 0;
+    else history[i - hbase] = 0.0;
+  }
+  floor = f;
+}
+
+
+// the history keeps the samples needed by the tuning, the last frame and the candidates still to be decoded
+void Cdecoder::trim()
+{
+  long long keep;
+
+  switch(stage) {
+    case FRAME:	keep = position() - (48*N + GAP + N/4 + detector.span() + 2*N);
+		if(!candidates.empty() && (candidates.front().sample < keep)) keep = candidates.front().sample;
+		break;
+    case DONE:	keep = position() - (N + 2*Nsync);
+		break;
+    default:	keep = next - (N + 2*Nsync);
+  }
+
+  if(keep - hbase > 4*N) {
+    if(s16) history16.erase(history16.begin(), history16.begin() + (keep - hbase));
+    else history.erase(history.begin(), history.begin() + (keep - hbase));
+    hbase = keep;
+  }
+}
@@ -0,0 +1,164 @@
+/*
+    Class Cdecoder - Part of the SRCclock program.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CDECODER_H
+#define CDECODER_H
+
+
+#include <vector>
+#include <deque>
+#include <cstddef>
+#include <cstdint>
+#include "cgoertzel.h"
+#include "csdft.h"
+#include "cdetector.h"
+#include "cnoise.h"
+
+
+class Csrc;
+
+
+
+/**
+ * @brief Types of the events emitted by Cdecoder
+ */
+enum Cevent_type {
+  EVENT_SYMBOL,		/**< A symbol of the frame has been decided. value is the bit (-1 = under threshold) */
+  EVENT_RESET,		/**< The symbols received so far are not valid and the acquisition restarts. value is the error code */
+  EVENT_FRAME,		/**< The frame has been decoded. The sample is the first one after the frame; value is the number of bits corrected */
+  EVENT_TICK,		/**< A syncronisation tone RP has been received */
+  EVENT_SYNC,		/**< All the RP have been received. The sample is the first one after the last RP */
+  EVENT_TIMEOUT		/**< The timeout expired. value is 0 while acquiring the frame, 1 while waiting for the RP */
+};
+
+
+/**
+ * @brief Event of the decoding. The timestamp is the index of a sample since the first one fed to the decoder
+ */
+struct Cevent {
+  int type;		/**< One of Cevent_type */
+  long long sample;	/**< Sample index of the event: beginning of the symbol or of the RP, end of the frame or of the syncronisation */
+  int index;		/**< Number of the symbol [0, 47] or of the RP [1, 7] */
+  int value;		/**< Bit of the symbol, error code or stage of the timeout */
+  double power;		/**< Power of the tone (linear) */
+  double fraction;	/**< Sub-sample offset of the last alignment of the tones (see Csrc::microsecDelay()) */
+};
+
+
+
+/**
+ * @brief Push style decoder of the SRC signal.
+ *
+ * The decoder does not read any stream: the samples are given to feed() in chunks of any size and the decoder moves
+ * through its stages (acquisition of the frame, syncronisation) as soon as enough samples are available. The results are
+ * queued as events, each one with the index of the sample it refers to, and the decoded date is stored in the Csrc
+ * object given to the constructor, whose settings (thresholds, WDS, frame detection, timeout, sync) are used.
+ * Csrc::decode() is a loop that reads the stream and feeds the decoder; wanted() tells how many samples are needed to
+ * reach the next decision, so a reader can stop exactly at the end of a symbol.
+ * A decoder of 16 bit samples keeps them as they are, at half the memory, and computes the symbols and the RP with the
+ * fixed point Goertzel; the tuning works on the integers as well, only the matched filter detector gets them in float.
+ *
+ * @class Cdecoder
+ * @author Vittorio Tornielli di Crestvolant   <vittorio.tornielli@gmail.com>
+ * @version 1.0
+ * @date 2009-2014
+ */
+
+class Cdecoder {
+    Csrc& src;
+    int fc;			// sampling frequency
+    int stage;
+    int N, DELTA, GAP;		// samples of a symbol, of the tuning range and of the silence between the blocks
+    int Nsync;			// samples of a window of the syncronisation
+
+    bool s16;			// the history keeps 16 bit samples
+    std::vector<float> history;	// history[0] is the sample number hbase. The samples before the floor are zeros
+    std::vector<int16_t> history16;	// the history of a decoder of 16 bit samples (history is then empty)
+    std::vector<float> piece;	// 16 bit samples converted for the detector
+    long long hbase;
+    long long floor;		// the samples before floor are read as zeros
+    long long begin;		// first sample of the current decoding
+    long long next;		// first sample of the next window
+    std::deque<Cevent> events;
+
+    int c;			// symbols or RP received
+    int weak;			// symbols under threshold decided anyway, for the correction of the frame
+    long long total;		// windows processed
+    double avg;			// average power of the tones
+    Cnoise noise;		// noise level of the last symbols for the WDS
+
+    bool tune;			// waiting for the samples of the tuning
+    long long detected;		// window where the tone has been detected
+    int pending_bit;
+    double pending[2];
+
+    int ticks, noise_symbols;
+
+    const Cgoertzel symbol_tones;
+    const Cgoertzel sync_tone;
+    const Csdft symbol_trace;	// F0 and F1 over a symbol, for the tuning of the symbols and of ID2
+    const Csdft sync_trace;	// Fsync over a window of the syncronisation
+    Cdetector detector;
+    std::deque<Cdetection> candidates;
+
+public:
+    Cdecoder(Csrc& s, bool s16le = false);	/**< Decoder using the settings of s. The stream of s sets the sampling frequency. With s16le the decoder is fed 16 bit samples */
+
+    void start();		/**< Start a new decoding from the next sample fed. The index of the samples is not reset */
+
+
+    /**
+     * @brief Process new samples of the stream
+     *
+     * @param x Pointer to the samples (mono)
+     * @param n Number of samples
+     */
+    void feed(const float* x, size_t n);
+    void feed(const int16_t* x, size_t n);	/**< Process new 16 bit samples (full scale 32768) */
+
+    bool event(Cevent& e);	/**< Extract the next event. Returns false if none is available */
+
+    int wanted() const;		/**< Return the number of samples to be fed before the next decision */
+    bool done() const;		/**< Return true when the decoding has finished (decoded, syncronised or timed out) */
+    long long position() const { return hbase + (long long)(s16 ? history16.size() : history.size()); }	/**< Return the number of samples fed so far */
+
+private:
+    enum { ACQUIRE, FRAME, SYNC, DONE };
+
+    void advance(const float* x, const int16_t* q, size_t k);	// the k samples just added to the history, in float or 16 bit
+    void process();
+    bool acquire();		// symbol by symbol acquisition of the frame
+    bool acquire_frame();	// acquisition of the whole frame through the matched filter detector
+    bool sync();		// syncronisation with the RP tones
+    void symbol(int bit, const double* p);
+    bool soft_decision() const;	// a symbol under threshold may be decided by its soft value
+    void end_of_pass();
+    void frame_found();
+    void start_sync();
+    void expire(int at);		// the timeout of the frame (0) or of the syncronisation (1) expired
+    void emit(int type, long long sample, int index, int value, double power);
+
+    long long tuning(const Csdft& dft, int tone, long long s, int delta, double& p);
+    void power(const Cgoertzel& g, long long s, int n, double* p) const;	// power of the tones of g over the n samples from s
+    void trace(const Csdft& dft, int tone, long long s, int windows, double* p) const;	// power trace of a tone from s
+    void clear(long long f);	// the samples before f are set to zero
+    void trim();
+};
+
+#endif // CDECODER_H
@@ -0,0 +1,173 @@
+/*
+    Class Cdetector - Implementation.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cmath>
+#include "cdetector.h"
+
+
+using std::complex;
+
+
+
+Cdetector::Cdetector(int fc, int f0, int f1, int symbol_samples, int symbols)
+: fft(4*symbol_samples)
+{
+  const int L = fft.size();
+  N = symbol_samples;
+  K = (symbols < 2) ? 2 : symbols;
+  hop = L - N + 1;			// outputs of each block not affected by the circular wrap
+  threshold = 0.5;
+  power_floor = 0.0;
+
+  H0.assign(L, complex<double>(0.0, 0.0));
+  H1.assign(L, complex<double>(0.0, 0.0));
+  X.resize(L);
+  Y.resize(L);
+
+  /* The correlation c[t] = sum x[t+m] h[m] is the circular convolution of x with the reversed template.
+     Its spectrum is X(k)*conj(FFT(conj(h))) */
+  for(int m = 0; m < N; m++) {
+    H0[m] = std::polar(1.0, 2.0*M_PI*f0*m/fc);		// conj(h0[m]) with h0[m] = e^{-jw0m}
+    H1[m] = std::polar(1.0, 2.0*M_PI*f1*m/fc);
+  }
+  fft.forward(&H0[0]);
+  fft.forward(&H1[0]);
+  for(int k = 0; k < L; k++) {
+    H0[k] = std::conj(H0[k]);
+    H1[k] = std::conj(H1[k]);
+  }
+
+  reset();
+}
+
+
+void Cdetector::reset()
+{
+  input.clear();
+  c0.clear();
+  c1.clear();
+  energy.assign(1, 0.0);
+  base = 0;
+  next = 0;
+  open = false;
+  found.clear();
+}
+
+
+
+void Cdetector::feed(const float* x, int n)
+{
+  double e = energy.back();
+
+  for(int i = 0; i < n; i++) {
+    input.push_back(x[i]);
+    e += double(x[i])*x[i];
+    energy.push_back(e);
+  }
+
+  correlate();
+  score();
+  trim();
+}
+
+
+bool Cdetector::detection(Cdetection& d)
+{
+  if(found.empty()) return false;
+
+  d = found.front();
+  found.pop_front();
+  return true;
+}
+
+
+
+void Cdetector::correlate()
+{
+  const int L = fft.size();
+
+  while(int(input.size()) >= L) {
+    for(int i = 0; i < L; i++) X[i] = input[i];
+    fft.forward(&X[0]);
+
+    for(int k = 0; k < L; k++) {
+      Y[k] = X[k]*H1[k];
+      X[k] *= H0[k];
+    }
+    fft.inverse(&X[0]);
+    fft.inverse(&Y[0]);
+
+    for(int t = 0; t < hop; t++) {
+      c0.push_back(std::norm(X[t]));
+      c1.push_back(std::norm(Y[t]));
+    }
+
+    input.erase(input.begin(), input.begin() + hop);	// overlap-save: the last N-1 samples are kept
+  }
+}
+
+
+void Cdetector::score()
+{
+  const double norm = N/2.0;	// energy of a tone of unitary amplitude over a symbol is N/2, its |c|^2 is N^2/4
+  double tones, E, sc;
+  long long s;
+
+  while(((next - base + (K-1)*N) < (long long)(c0.size())) && ((next - base + K*N) < (long long)(energy.size()))) {
+    s = next - base;
+
+    tones = c0[s] + c1[s + N];				// ID1: "01"
+    for(int j = 2; j < K; j++)
+      tones += (c0[s + j*N] > c1[s + j*N]) ? c0[s + j*N] : c1[s + j*N];
+
+    E = energy[s + K*N] - energy[s];
+    sc = (E > 0.0) ? tones/(norm*E) : 0.0;
+
+    if(open && ((next - best.sample) > N/2)) {		// no better candidate close to the previous one
+      found.push_back(best);
+      open = false;
+    }
+
+    if((sc >= threshold) && (tones*4.0/(double(N)*N*K) >= power_floor) && (!open || (sc > best.score))) {
+      best.sample = next;
+      best.score = sc;
+      open = true;
+    }
+
+    next++;
+  }
+}
+
+
+void Cdetector::trim()
+{
+  const long long drop = next - base;
+  double e0;
+
+  if(drop < 8*N) return;		// not worth moving the data yet
+
+  c0.erase(c0.begin(), c0.begin() + drop);
+  c1.erase(c1.begin(), c1.begin() + drop);
+  energy.erase(energy.begin(), energy.begin() + drop);
+
+  e0 = energy[0];			// keeps the cumulative energy small
+  for(unsigned int i = 0; i < energy.size(); i++) energy[i] -= e0;
+
+  base = next;
+}
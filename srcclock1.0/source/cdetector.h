@@ -0,0 +1,113 @@
+/*
+    Class Cdetector - Part of the SRCclock program.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CDETECTOR_H
+#define CDETECTOR_H
+
+
+#include <vector>
+#include <deque>
+#include <complex>
+#include "cfft.h"
+
+
+
+/**
+ * @brief Candidate beginning of an SRC frame found by Cdetector
+ */
+struct Cdetection {
+  long long sample;	/**< Index of the first sample of the frame since the beginning of the stream */
+  double score;		/**< Correlation score in the range [0, 1]. 1 is a clean SRC signal */
+};
+
+
+
+/**
+ * @brief Matched filter detector of the beginning of the SRC frames.
+ *
+ * The incoming samples are correlated with the F0 and F1 tones of one symbol through an overlap-save FFT convolution.
+ * The template of the frame is made of the ID1 bits "01" followed by symbols that are known to be either F0 or F1:
+ * the score of a starting sample adds the energy of F0 in the first symbol, the energy of F1 in the second one and
+ * the strongest of the two tones in the next ones. The sum is normalized by the energy of the signal under the template,
+ * so the score does not depend on the level of the signal. The local maxima over the threshold are the candidates.
+ *
+ * @class Cdetector
+ * @author Vittorio Tornielli di Crestvolant   <vittorio.tornielli@gmail.com>
+ * @version 1.0
+ * @date 2009-2014
+ */
+
+class Cdetector {
+    int N;			// samples of each symbol
+    int K;			// symbols of the template
+    int hop;			// new correlation values for each FFT block
+    Cfft fft;
+    std::vector<std::complex<double> > H0, H1;		// spectra of the templates of the tones
+    std::vector<std::complex<double> > X, Y;		// work areas
+
+    std::vector<float> input;				// samples waiting for the next FFT block
+    std::vector<double> c0, c1;				// energy of the tones of the window starting at each sample
+    std::vector<double> energy;				// cumulative energy of the samples
+    long long base;		// sample corresponding to the first element of c0, c1 and energy
+    long long next;		// next starting sample to be scored
+
+    double threshold;		// minimum score of the candidates
+    double power_floor;		// minimum average power of the tones
+    bool open;			// a candidate is waiting for its local maximum
+    Cdetection best;
+    std::deque<Cdetection> found;
+
+public:
+    /**
+     * @brief Detector of the frames
+     *
+     * @param fc Sampling frequency
+     * @param f0 Frequency of the tone of bit 0
+     * @param f1 Frequency of the tone of bit 1
+     * @param symbol_samples Number of samples of each symbol
+     * @param symbols Number of symbols of the template (at least 2, the ID1 bits)
+     */
+    Cdetector(int fc, int f0, int f1, int symbol_samples, int symbols = 16);
+
+    void reset();		/**< Forget all the samples. The next sample fed has index 0 */
+
+    void set_threshold(double score) { threshold = score; }	/**< Minimum score of the candidates. Default 0.5 */
+    void set_power_floor(double p) { power_floor = p; }	/**< Minimum average power of the tones (linear) */
+
+
+    /**
+     * @brief Process new samples of the stream
+     *
+     * @param x Pointer to the samples
+     * @param n Number of samples
+     */
+    void feed(const float* x, int n);
+
+    bool detection(Cdetection& d);	/**< Extract the next candidate. Returns false if none is available */
+
+    long long processed() const { return next; }	/**< Number of starting samples already scored */
+    int span() const { return K*N; }			/**< Number of samples covered by the template */
+
+private:
+    void correlate();		// FFT blocks of the available input
+    void score();		// score of the starting samples whose template is complete
+    void trim();		// remove the data not needed anymore
+};
+
+#endif // CDETECTOR_H
@@ -0,0 +1,242 @@
+/*
+    Class Cengine - Implementation.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <thread>
+#include "cengine.h"
+#include "csrc.h"
+
+
+#define SLICE		0.5	// seconds of a stream decoded before giving the thread to the next stream
+
+
+
+Cengine::Cengine(const Csrc& s)
+: settings(s)
+{
+  repeat = 1;
+  iso = false;
+  running = false;
+  active = 0;
+}
+
+Cengine::~Cengine()
+{
+  for(unsigned int i = 0; i < streams.size(); i++) {
+    delete streams[i]->decoder;
+    streams[i]->src->close_all();
+    delete streams[i]->src;
+    delete streams[i];
+  }
+}
+
+
+
+int Cengine::add(const std::string& input, int fc, int channels, bool s16le)
+{
+  const pa_sample_format format = s16le ? PA_SAMPLE_S16LE : PA_SAMPLE_FLOAT32LE;
+  Cstream* s = new Cstream;
+  Csrc& src = *(s->src = new Csrc);
+  bool open;
+  int size;
+
+  src = settings;
+  src.verbose_level = 0;		// the threads would mix their logs
+
+  if(input.compare(0, 3, "pa:") == 0) {
+    std::string device = input.substr(3);
+    open = src.open_soundStream_input(fc, channels, device.empty() ? NULL : device.c_str(), format);
+  }
+  else open = src.open_file_input(input.c_str(), fc, channels, format);
+
+  if(!open) {
+    delete s->src;
+    delete s;
+    return -1;
+  }
+
+  size = 2*int(0.1*src.sample_frequency) + int(src.sample_frequency*src.Ts);	// longest read requested by the decoder
+  s->input = input;
+  s->buffer.resize(size*channels);
+  s->decoder = new Cdecoder(src);
+  s->remaining = 0;
+
+  streams.push_back(s);
+
+  return streams.size() - 1;
+}
+
+
+
+int Cengine::run(int threads)
+{
+  std::vector<std::thread> pool;
+  std::vector<int> reports;
+  int total = 0;
+
+  if(streams.empty()) return 0;
+
+  if(threads <= 0) threads = std::thread::hardware_concurrency();
+  if(threads <= 0) threads = 1;
+  if(threads > int(streams.size())) threads = streams.size();
+
+  ready.clear();
+  for(unsigned int i = 0; i < streams.size(); i++) {
+    Cstream& s = *streams[i];
+
+    s.remaining = (repeat > 0) ? repeat : -1;
+    clear(s.minute);
+    s.src->running = true;
+    s.src->late_samples = 0;
+    s.decoder->start();
+    ready.push_back(i);
+  }
+  active = streams.size();
+  running = true;
+
+  reports.assign(threads, 0);
+  for(int t = 0; t < threads; t++) pool.push_back(std::thread(&Cengine::work, this, std::ref(reports[t])));
+  for(int t = 0; t < threads; t++) {
+    pool[t].join();
+    total += reports[t];
+  }
+
+  running = false;
+  for(unsigned int i = 0; i < streams.size(); i++) streams[i]->src->running = false;
+
+  return total;
+}
+
+
+void Cengine::stop()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  running = false;
+}
+
+
+
+void Cengine::work(int& reports)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  bool more;
+  int id;
+
+  while(true) {
+    queue_cv.wait(lock, [this]() { return !ready.empty() || (active == 0); });
+    if(ready.empty()) return;		// all the streams have finished
+
+    id = ready.front();
+    ready.pop_front();
+    more = running;
+
+    lock.unlock();
+    if(more) more = slice(id, reports);	// the stream is decoded by one thread at a time
+    lock.lock();
+
+    if(more) {
+      ready.push_back(id);
+      queue_cv.notify_one();
+    }
+    else if(--active == 0) queue_cv.notify_all();
+  }
+}
+
+
+
+bool Cengine::slice(int id, int& reports)
+{
+  Cstream& s = *streams[id];
+  Csrc& src = *s.src;
+  Cdecoder& decoder = *s.decoder;
+  const int size = s.buffer.size()/src.soundChannels;
+  const long long end = decoder.position() + (long long)(SLICE*src.sample_frequency);
+  Cevent e;
+  int n;
+
+  while(decoder.position() < end) {
+    n = decoder.wanted();
+    if(n > size) n = size;
+
+    if(src.readBuffer(&s.buffer[0], n) < 0) {	// end of the stream or reading error
+      if(src.decoded) {		// the RP are missing
+        finish(id);
+        reports++;
+      }
+      return false;
+    }
+
+    decoder.feed(&s.buffer[0], n);	// at the end of the stream the missing samples are zeros
+
+    while(decoder.event(e)) {
+      switch(e.type) {
+        case EVENT_FRAME:	s.minute.frame = e.sample;
+				src.late_samples = decoder.position() - e.sample;	// samples read after the reference of the timing
+				break;
+        case EVENT_TICK:	if(s.minute.frame >= 0) s.minute.ticks.push_back(e.sample);
+				break;
+        case EVENT_SYNC:	s.minute.sync = e.sample;
+				s.minute.fraction = e.fraction;
+				src.late_samples = decoder.position() - e.sample;
+				break;
+        default:		break;
+      }
+    }
+
+    if(decoder.done()) {
+      finish(id);
+      reports++;
+      if((s.remaining > 0) && (--s.remaining == 0)) return false;
+      decoder.start();
+    }
+  }
+
+  return true;
+}
+
+
+
+void Cengine::finish(int id)
+{
+  Cstream& s = *streams[id];
+  const Csrc& src = *s.src;
+  Creport r;
+
+  r.stream = id;
+  r.input = s.input;
+  r.decoded = src.OK();
+  r.sincronized = src.sincronized();
+  r.error = src.internalError();
+  r.minute = s.minute;
+  if(r.decoded) r.minute.date = src.dateSTR(iso);
+  r.microsec = src.getMilliseconds()*1000l + src.microsecDelay();
+
+  clear(s.minute);
+
+  std::unique_lock<std::mutex> lock(report_mutex);
+  if(report) report(r);
+}
+
+
+void Cengine::clear(Cminute& m)
+{
+  m.frame = m.sync = -1;
+  m.fraction = 0.0;
+  m.ticks.clear();
+  m.date.clear();
+}
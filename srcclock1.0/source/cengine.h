@@ -0,0 +1,137 @@
+/*
+    Class Cengine - Part of the SRCclock program.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CENGINE_H
+#define CENGINE_H
+
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include "cscanner.h"
+
+
+class Csrc;
+class Cdecoder;
+
+
+
+/**
+ * @brief Result of a decoding reported by Cengine
+ */
+struct Creport {
+  int stream;		/**< ID of the stream: its position in the list of inputs, from 0 */
+  std::string input;	/**< Name of the input */
+  bool decoded;		/**< The frame has been decoded */
+  bool sincronized;	/**< The frame has been decoded and syncronised with the RP */
+  int error;		/**< Internal error of the decoding (see Csrc::internalError()) */
+  Cminute minute;	/**< Date, frame and syncronisation. The sample indexes count the samples of the stream since it was opened */
+  long microsec;	/**< Microseconds elapsed since the reference second of the date (see Csrc::microsecDelay()), when reported */
+};
+
+
+
+/**
+ * @brief Decode many input streams in one process on a fixed pool of threads.
+ *
+ * Each input (file, named pipe or sound device) is opened on its own Csrc object, a copy of the decoding settings, and
+ * keeps its own Cdecoder. The streams waiting to be decoded are queued: a free thread of the pool takes the first one,
+ * reads and decodes a slice of the stream (some tenths of second), then puts it back at the end of the queue. So the
+ * threads are as many as the cores, whatever the number of streams, and the sound server buffers the live streams while
+ * they wait their turn. Each decoding (decoded, syncronised or timed out) is reported with the ID of its stream; the
+ * decoder restarts on the same stream until the given number of decodings or the end of the stream.
+ *
+ * @class Cengine
+ * @author Vittorio Tornielli di Crestvolant   <vittorio.tornielli@gmail.com>
+ * @version 1.0
+ * @date 2009-2014
+ */
+
+class Cengine {
+    struct Cstream {
+      std::string input;
+      Csrc* src;		// stream, settings and date
+      Cdecoder* decoder;
+      std::vector<float> buffer;
+      int remaining;		// decodings still to do. Negative values for unlimited decodings
+      Cminute minute;		// current decoding
+    };
+
+    const Csrc& settings;	// decoding settings (thresholds, WDS, frame detection, sync, timeout, decimation)
+    std::vector<Cstream*> streams;
+    int repeat;			// decodings of each stream. 0 = unlimited
+    bool iso;			// date in the format ISO 8601
+    bool running;
+
+    std::deque<int> ready;	// streams waiting for a thread
+    int active;			// streams not finished
+    std::mutex mutex;
+    std::condition_variable queue_cv;
+    std::mutex report_mutex;	// the reports are given one at a time
+    std::function<void(const Creport&)> report;
+
+public:
+    Cengine(const Csrc& s);	/**< Engine using the decoding settings of s */
+    ~Cengine();
+
+
+    /**
+     * @brief Open an input stream
+     *
+     * @param input Name of the file or of the named pipe (float samples, interleaved if stereo). The name "pa:DEVICE"
+     *              opens the sound device DEVICE of the sound server; "pa:" opens the default one
+     * @param fc Sampling frequency
+     * @param channels Channels: 1 = mono; 2 = stereo (the channels are averaged)
+     * @param s16le The samples are 16 bit little endian integers instead of float
+     * @return int ID of the stream, -1 if it cannot be opened
+     */
+    int add(const std::string& input, int fc, int channels, bool s16le = false);
+
+
+    /**
+     * @brief Decode all the streams on a pool of threads. Returns when all the streams have finished
+     *
+     * @param threads Number of threads. 0 = one for each core
+     * @return int number of decodings reported
+     */
+    int run(int threads = 0);
+
+    void stop();		/**< The threads stop after the slice of stream being decoded */
+
+    void set_repeat(int times) { repeat = times; }	/**< Decodings of each stream (0 = unlimited, till the end of the stream). Default 1 */
+    void set_iso(bool iso8601) { iso = iso8601; }		/**< Dates in the format ISO 8601 instead of RFC 2822 */
+
+    /**
+     * @brief Set the function receiving the reports. It is called by the threads of the pool, one call at a time
+     */
+    void on_report(const std::function<void(const Creport&)>& f) { report = f; }
+
+    int size() const { return streams.size(); }	/**< Return the number of streams */
+
+private:
+    void work(int& reports);	// thread of the pool
+    bool slice(int id, int& reports);	// decodes a slice of the stream. Returns false when the stream has finished
+    void finish(int id);	// reports the current decoding
+    static void clear(Cminute& m);
+};
+
+#endif // CENGINE_H
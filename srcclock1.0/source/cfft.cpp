@@ -0,0 +1,98 @@
+/*
+    Class Cfft - Implementation.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cmath>
+#include "cfft.h"
+
+
+using std::complex;
+
+
+
+Cfft::Cfft()
+{
+  set(2);
+}
+
+Cfft::Cfft(int size)
+{
+  set(size);
+}
+
+
+void Cfft::set(int size)
+{
+  int bits = 0;
+
+  L = 1;
+  while(L < size) {
+    L <<= 1;
+    bits++;
+  }
+
+  twiddle.resize(L/2);
+  for(int k = 0; k < L/2; k++)
+    twiddle[k] = std::polar(1.0, -2.0*M_PI*k/L);
+
+  reversed.resize(L);
+  for(int i = 0; i < L; i++) {
+    int r = 0;
+    for(int b = 0; b < bits; b++)
+      if(i & (1 << b)) r |= 1 << (bits - 1 - b);
+    reversed[i] = r;
+  }
+}
+
+
+void Cfft::forward(complex<double>* x) const
+{
+  transform(x, false);
+}
+
+
+void Cfft::inverse(complex<double>* x) const
+{
+  transform(x, true);
+
+  for(int i = 0; i < L; i++) x[i] /= L;
+}
+
+
+// iterative Cooley-Tukey, decimation in time
+void Cfft::transform(complex<double>* x, bool inv) const
+{
+  complex<double> w, t;
+
+  for(int i = 0; i < L; i++)
+    if(i < reversed[i]) std::swap(x[i], x[reversed[i]]);
+
+  for(int len = 2; len <= L; len <<= 1) {
+    const int half = len/2;
+    const int step = L/len;
+
+    for(int i = 0; i < L; i += len) {
+      for(int k = 0; k < half; k++) {
+        w = inv ? std::conj(twiddle[k*step]) : twiddle[k*step];
+        t = w*x[i + k + half];
+        x[i + k + half] = x[i + k] - t;
+        x[i + k] += t;
+      }
+    }
+  }
+}
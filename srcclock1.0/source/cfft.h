@@ -0,0 +1,57 @@
+/*
+    Class Cfft - Part of the SRCclock program.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CFFT_H
+#define CFFT_H
+
+
+#include <vector>
+#include <complex>
+
+
+
+/**
+ * @brief Radix-2 complex FFT of fixed size. The twiddle factors and the bit reversal table are calculated once.
+ *
+ * @class Cfft
+ * @author Vittorio Tornielli di Crestvolant   <vittorio.tornielli@gmail.com>
+ * @version 1.0
+ * @date 2009-2014
+ */
+
+class Cfft {
+    int L;					// size of the transform (power of 2)
+    std::vector<std::complex<double> > twiddle;	// e^{-j2*pi*k/L}, k < L/2
+    std::vector<int> reversed;			// bit reversal permutation
+
+public:
+    Cfft();
+    Cfft(int size);		/**< FFT of size samples. The size is rounded up to a power of 2 */
+
+    void set(int size);		/**< Change the size of the transform. The size is rounded up to a power of 2 */
+    int size() const { return L; }	/**< Return the size of the transform */
+
+    void forward(std::complex<double>* x) const;	/**< In place direct transform of size() samples */
+    void inverse(std::complex<double>* x) const;	/**< In place inverse transform of size() samples (scaled by 1/size()) */
+
+private:
+    void transform(std::complex<double>* x, bool inv) const;
+};
+
+#endif // CFFT_H
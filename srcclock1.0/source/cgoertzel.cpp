@@ -0,0 +1,298 @@
+/*
+    Class Cgoertzel - Implementation.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cmath>
+#include <algorithm>
+#include "cgoertzel.h"
+#include "csimd.h"
+
+
+#define MAX_LANES 64		// lanes processed by each call of the kernel
+#define Q 28			// fractional bits of the fixed point coefficients
+#define Q_STATE 18		// the fixed point state cannot overflow for windows up to 2^Q_STATE*sin(2*pi*f/fc) samples
+
+
+
+Cgoertzel::Cgoertzel()
+{
+  sample_frequency = 8000;
+  max_q = 0;
+}
+
+Cgoertzel::Cgoertzel(int fc, int f0)
+{
+  set(fc, std::vector<int>(1, f0));
+}
+
+Cgoertzel::Cgoertzel(int fc, int f0, int f1)
+{
+  std::vector<int> f(2);
+
+  f[0] = f0;
+  f[1] = f1;
+  set(fc, f);
+}
+
+Cgoertzel::Cgoertzel(int fc, const std::vector<int>& frequencies)
+{
+  set(fc, frequencies);
+}
+
+
+void Cgoertzel::set(int fc, const std::vector<int>& frequencies)
+{
+  sample_frequency = fc;
+  freq = frequencies;
+  coeff.resize(freq.size());
+  coeff_q.resize(freq.size());
+  max_q = 1 << Q_STATE;
+
+  /* The state of the recurrence is at most 32768*n/|sin(w)| after n samples, and |c| <= 2^(Q+1): the product c*V1
+     stays under 2^62 if n/|sin(w)| < 2^Q_STATE.
+  */
+  for(unsigned int i = 0; i < freq.size(); i++) {
+    const double w = 2.0 * M_PI * freq[i] / sample_frequency;
+    coeff[i] = 2.0*cos(w);
+    coeff_q[i] = int32_t(lround(coeff[i]*(1 << Q)));
+    max_q = std::min(max_q, int(fabs(sin(w))*(1 << Q_STATE)));
+  }
+}
+
+
+
+void Cgoertzel::power(const float* data, int samples, double* p) const
+{
+  const float* d[MAX_LANES];
+  const int tones = freq.size();
+  int lanes;
+
+  for(int i = 0; i < MAX_LANES; i++) d[i] = data;	// all the tones share the same window
+
+  for(int t = 0; t < tones; t += lanes) {
+    lanes = (tones - t < MAX_LANES) ? tones - t : MAX_LANES;
+    kernel(&coeff[t], d, lanes, samples, p + t);
+  }
+}
+
+
+
+void Cgoertzel::power(const int16_t* data, int samples, double* p) const
+{
+  const int tones = freq.size();
+  int lanes;
+
+  if(samples > max_q) {		// too long for the fixed point state
+    std::vector<float> x(samples);
+
+    for(int i = 0; i < samples; i++) x[i] = data[i]*(1.0f/32768);
+    power(&x[0], samples, p);
+    return;
+  }
+
+  for(int t = 0; t < tones; t += lanes) {
+    lanes = (tones - t < MAX_LANES) ? tones - t : MAX_LANES;
+    kernel_q(&coeff_q[t], data, lanes, samples, p + t);
+  }
+
+  for(int l = 0; l < tones; l++)
+    p[l] = p[l]/(double(samples)*samples)*4;		// normalization: power of the single side sinusoid
+}
+
+
+
+int Cgoertzel::simd_level()
+{
+  return ::simd_level();
+}
+
+
+const char* Cgoertzel::simd_name()
+{
+  const char* names[] = {"scalar", "SSE2", "AVX2"};
+
+  return names[simd_level()];
+}
+
+
+
+void Cgoertzel::kernel(const double* c, const float* const* data, int lanes, int samples, double* p)
+{
+  switch(simd_level()) {
+    case 2:	kernel_avx2(c, data, lanes, samples, p);
+		break;
+    case 1:	kernel_sse2(c, data, lanes, samples, p);
+		break;
+    default:	kernel_scalar(c, data, lanes, samples, p);
+  }
+
+  for(int l = 0; l < lanes; l++)
+    p[l] = p[l]/(double(samples)*samples)*4;		// normalization: power of the single side sinusoid
+}
+
+
+// Each lane runs the recurrence V0 = x[i] + c*V1 - V2. The not normalized power is V2^2 + V1^2 - c*V2*V1
+void Cgoertzel::kernel_scalar(const double* c, const float* const* data, int lanes, int samples, double* p)
+{
+  double V0, V1, V2;
+
+  for(int l = 0; l < lanes; l++) {
+    const float* x = data[l];
+
+    V1 = V2 = 0.0;
+    for(int i = 0; i < samples; i++) {
+      V0 = x[i] + (c[l] * V1) - V2;
+      V2 = V1;
+      V1 = V0;
+    }
+    p[l] = V2*V2 + V1*V1 - c[l]*V2*V1;
+  }
+}
+
+
+// The recurrence V0 = x[i] + c*V1 - V2 on integers: the product c*V1 is rounded back to the scale of the samples.
+// Two lanes run in the same loop, so the latency of the multiplication of one is hidden by the other
+void Cgoertzel::kernel_q(const int32_t* c, const int16_t* data, int lanes, int samples, double* p)
+{
+  const int64_t half = int64_t(1) << (Q - 1);
+  const double scale = 1.0/32768;
+  int l;
+
+  for(l = 0; l < lanes; l += 2) {
+    const int64_t Ca = c[l];
+    const int64_t Cb = (l + 1 < lanes) ? c[l+1] : 0;
+    int64_t V0a, V1a, V2a, V0b, V1b, V2b;
+    double v1, v2, cd;
+
+    V1a = V2a = V1b = V2b = 0;
+    for(int i = 0; i < samples; i++) {
+      V0a = data[i] + ((Ca*V1a + half) >> Q) - V2a;
+      V0b = data[i] + ((Cb*V1b + half) >> Q) - V2b;
+      V2a = V1a;
+      V1a = V0a;
+      V2b = V1b;
+      V1b = V0b;
+    }
+
+    v1 = V1a*scale;
+    v2 = V2a*scale;
+    cd = double(Ca)/(1 << Q);
+    p[l] = v2*v2 + v1*v1 - cd*v2*v1;
+    if(l + 1 < lanes) {
+      v1 = V1b*scale;
+      v2 = V2b*scale;
+      cd = double(Cb)/(1 << Q);
+      p[l+1] = v2*v2 + v1*v1 - cd*v2*v1;
+    }
+  }
+}
+
+
+#ifdef SRC_X86
+
+__attribute__((target("sse2")))
+void Cgoertzel::kernel_sse2(const double* c, const float* const* data, int lanes, int samples, double* p)
+{
+  int l;
+
+  for(l = 0; l + 2 <= lanes; l += 2) {
+    const float *x0 = data[l], *x1 = data[l+1];
+    const __m128d C = _mm_loadu_pd(&c[l]);
+    __m128d V0, V1, V2;
+
+    V1 = V2 = _mm_setzero_pd();
+    for(int i = 0; i < samples; i++) {
+      V0 = _mm_sub_pd(_mm_add_pd(_mm_set_pd(x1[i], x0[i]), _mm_mul_pd(C, V1)), V2);
+      V2 = V1;
+      V1 = V0;
+    }
+    V0 = _mm_sub_pd(_mm_add_pd(_mm_mul_pd(V2, V2), _mm_mul_pd(V1, V1)), _mm_mul_pd(_mm_mul_pd(C, V2), V1));
+    _mm_storeu_pd(&p[l], V0);
+  }
+
+  if(l < lanes) kernel_scalar(&c[l], &data[l], lanes - l, samples, &p[l]);
+}
+
+
+__attribute__((target("avx2")))
+void Cgoertzel::kernel_avx2(const double* c, const float* const* data, int lanes, int samples, double* p)
+{
+  int l;
+
+  // two independent groups of 4 lanes hide the latency of the recurrence
+  for(l = 0; l + 8 <= lanes; l += 8) {
+    const float* const* x = &data[l];
+    const __m256d Ca = _mm256_loadu_pd(&c[l]);
+    const __m256d Cb = _mm256_loadu_pd(&c[l+4]);
+    __m256d V0a, V1a, V2a, V0b, V1b, V2b;
+
+    V1a = V2a = V1b = V2b = _mm256_setzero_pd();
+    for(int i = 0; i < samples; i++) {
+      V0a = _mm256_sub_pd(_mm256_add_pd(_mm256_set_pd(x[3][i], x[2][i], x[1][i], x[0][i]), _mm256_mul_pd(Ca, V1a)), V2a);
+      V0b = _mm256_sub_pd(_mm256_add_pd(_mm256_set_pd(x[7][i], x[6][i], x[5][i], x[4][i]), _mm256_mul_pd(Cb, V1b)), V2b);
+      V2a = V1a;
+      V1a = V0a;
+      V2b = V1b;
+      V1b = V0b;
+    }
+    V0a = _mm256_sub_pd(_mm256_add_pd(_mm256_mul_pd(V2a, V2a), _mm256_mul_pd(V1a, V1a)), _mm256_mul_pd(_mm256_mul_pd(Ca, V2a), V1a));
+    V0b = _mm256_sub_pd(_mm256_add_pd(_mm256_mul_pd(V2b, V2b), _mm256_mul_pd(V1b, V1b)), _mm256_mul_pd(_mm256_mul_pd(Cb, V2b), V1b));
+    _mm256_storeu_pd(&p[l], V0a);
+    _mm256_storeu_pd(&p[l+4], V0b);
+  }
+
+  for(; l + 4 <= lanes; l += 4) {
+    const float *x0 = data[l], *x1 = data[l+1], *x2 = data[l+2], *x3 = data[l+3];
+    const __m256d C = _mm256_loadu_pd(&c[l]);
+    __m256d V0, V1, V2;
+
+    V1 = V2 = _mm256_setzero_pd();
+    if((x0 == x1) && (x0 == x2) && (x0 == x3)) {	// several tones on the same window
+      for(int i = 0; i < samples; i++) {
+        V0 = _mm256_sub_pd(_mm256_add_pd(_mm256_set1_pd(x0[i]), _mm256_mul_pd(C, V1)), V2);
+        V2 = V1;
+        V1 = V0;
+      }
+    }
+    else {
+      for(int i = 0; i < samples; i++) {
+        V0 = _mm256_sub_pd(_mm256_add_pd(_mm256_set_pd(x3[i], x2[i], x1[i], x0[i]), _mm256_mul_pd(C, V1)), V2);
+        V2 = V1;
+        V1 = V0;
+      }
+    }
+    V0 = _mm256_sub_pd(_mm256_add_pd(_mm256_mul_pd(V2, V2), _mm256_mul_pd(V1, V1)), _mm256_mul_pd(_mm256_mul_pd(C, V2), V1));
+    _mm256_storeu_pd(&p[l], V0);
+  }
+
+  if(l < lanes) kernel_sse2(&c[l], &data[l], lanes - l, samples, &p[l]);
+}
+
+#else
+
+void Cgoertzel::kernel_sse2(const double* c, const float* const* data, int lanes, int samples, double* p)
+{
+  kernel_scalar(c, data, lanes, samples, p);
+}
+
+void Cgoertzel::kernel_avx2(const double* c, const float* const* data, int lanes, int samples, double* p)
+{
+  kernel_scalar(c, data, lanes, samples, p);
+}
+
+#endif
@@ -0,0 +1,103 @@
+/*
+    Class Cgoertzel - Part of the SRCclock program.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CGOERTZEL_H
+#define CGOERTZEL_H
+
+
+#include <vector>
+#include <cstdint>
+
+
+
+/**
+ * @brief Multi-tone Goertzel engine. The power of every tone is computed in a single pass over the samples.
+ *
+ * Each tone is processed on its own lane. The lanes are packed in the AVX2 (4 doubles) or SSE2 (2 doubles) registers
+ * of the machine. The instruction set is chosen at runtime, a scalar implementation is used when no vector unit is
+ * available. The returned power is normalized as the
+ * power of the single side sinusoid, that is \f$4|X|^2/N^2\f$.
+ * The 16 bit samples are processed in fixed point: the coefficients are in Q28 and the recurrence runs on 64 bit
+ * integers, which cannot overflow for windows shorter than 2^18*sin(2*pi*f/fc) samples (e.g. 15000 samples for a tone
+ * at fc/100); longer windows are converted to float. Their power is scaled as the one of the samples divided by 32768,
+ * so the same thresholds apply.
+ *
+ * @class Cgoertzel
+ * @author Vittorio Tornielli di Crestvolant   <vittorio.tornielli@gmail.com>
+ * @version 1.0
+ * @date 2009-2014
+ */
+
+class Cgoertzel {
+    std::vector<int> freq;		// frequencies of the tones
+    std::vector<double> coeff;		// Goertzel coefficients 2cos(2*pi*f/fc)
+    std::vector<int32_t> coeff_q;	// the same coefficients in Q28
+    int max_q;				// longest window of 16 bit samples safe from overflow
+    int sample_frequency;
+
+public:
+    Cgoertzel();
+    Cgoertzel(int fc, int f0);				/**< Engine for a single tone */
+    Cgoertzel(int fc, int f0, int f1);			/**< Engine for two tones */
+    Cgoertzel(int fc, const std::vector<int>& frequencies);	/**< Engine for any number of tones */
+
+    /**
+     * @brief Set the sampling frequency and the tones of the engine
+     *
+     * @param fc Sampling frequency
+     * @param frequencies Frequencies of the tones in Hz
+     */
+    void set(int fc, const std::vector<int>& frequencies);
+
+    int tones() const { return freq.size(); }			/**< Return the number of tones */
+    int frequency(int tone) const { return freq[tone]; }	/**< Return the frequency of the tone */
+
+
+    /**
+     * @brief Power of every tone over the same window of samples
+     *
+     * @param data Pointer to the first sample of the window
+     * @param samples Number of samples of the window
+     * @param p Output array. At least tones() elements
+     */
+    void power(const float* data, int samples, double* p) const;
+
+
+    /**
+     * @brief Power of every tone over the same window of 16 bit samples, computed in fixed point
+     *
+     * @param data Pointer to the first sample of the window (full scale 32768)
+     * @param samples Number of samples of the window
+     * @param p Output array. At least tones() elements
+     */
+    void power(const int16_t* data, int samples, double* p) const;
+
+
+    static int simd_level();		/**< Instruction set used by the engine: 0 = scalar; 1 = SSE2; 2 = AVX2 */
+    static const char* simd_name();	/**< Name of the instruction set used by the engine */
+
+private:
+    static void kernel(const double* c, const float* const* data, int lanes, int samples, double* p);
+    static void kernel_scalar(const double* c, const float* const* data, int lanes, int samples, double* p);
+    static void kernel_sse2(const double* c, const float* const* data, int lanes, int samples, double* p);
+    static void kernel_avx2(const double* c, const float* const* data, int lanes, int samples, double* p);
+    static void kernel_q(const int32_t* c, const int16_t* data, int lanes, int samples, double* p);
+};
+
+#endif // CGOERTZEL_H
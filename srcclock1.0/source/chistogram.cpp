@@ -0,0 +1,99 @@
+/*
+    Class Chistogram - Implementation.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cmath>
+#include <algorithm>
+#include "chistogram.h"
+
+
+
+Chistogram::Chistogram(double bin_width, int size)
+{
+  set(bin_width, size);
+}
+
+
+void Chistogram::set(double bin_width, int size)
+{
+  width = (bin_width > 0.0) ? bin_width : 1.0;
+  bins.resize((size > 0) ? size + 1 : 2);
+
+  reset();
+}
+
+
+void Chistogram::reset()
+{
+  bins.assign(bins.size(), 0);
+  n = 0;
+  sum = sum2 = 0.0;
+  low = high = 0.0;
+}
+
+
+
+void Chistogram::add(double x)
+{
+  const int last = bins.size() - 1;
+  double k = floor(x/width);
+
+  if(k < 0) k = 0;
+  bins[(k < last) ? int(k) : last]++;
+
+  if((n == 0) || (x < low)) low = x;
+  if((n == 0) || (x > high)) high = x;
+  n++;
+  sum += x;
+  sum2 += x*x;
+}
+
+
+
+double Chistogram::mean() const
+{
+  return (n > 0) ? sum/n : 0.0;
+}
+
+
+double Chistogram::stddev() const
+{
+  double m = mean();
+  double v;
+
+  if(n < 2) return 0.0;
+
+  v = (sum2 - n*m*m)/(n - 1);
+  return (v > 0.0) ? sqrt(v) : 0.0;
+}
+
+
+double Chistogram::percentile(double q) const
+{
+  const long long rank = (long long)(ceil(q*n));
+  long long seen = 0;
+
+  if(n == 0) return 0.0;
+
+  for(unsigned int i = 0; i + 1 < bins.size(); i++) {
+    seen += bins[i];
+    if((seen >= rank) && (seen > 0)) return std::min((i + 1)*width, high);
+  }
+
+  return high;
+}
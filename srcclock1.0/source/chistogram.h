@@ -0,0 +1,74 @@
+/*
+    Class Chistogram - Part of the SRCclock program.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CHISTOGRAM_H
+#define CHISTOGRAM_H
+
+
+#include <vector>
+
+
+
+/**
+ * @brief Distribution of a measure (e.g. the interval between two readings of the stream) in bins of equal width.
+ *
+ * Adding a value costs the same whatever the number of values, and the memory is fixed by the number of bins. The
+ * values beyond the last bin are counted in an overflow bin; mean, standard deviation, minimum and maximum are exact,
+ * the percentiles are rounded up to the upper edge of their bin.
+ *
+ * @class Chistogram
+ * @author Vittorio Tornielli di Crestvolant   <vittorio.tornielli@gmail.com>
+ * @version 1.0
+ * @date 2009-2014
+ */
+
+class Chistogram {
+    double width;		// width of a bin
+    std::vector<long long> bins;	// the last one counts the values beyond the range
+    long long n;
+    double sum, sum2;
+    double low, high;
+
+public:
+    Chistogram(double bin_width = 1.0, int size = 1000);	/**< Histogram of size bins of bin_width from 0 */
+
+    void set(double bin_width, int size);	/**< Set the bins and reset the histogram */
+    void reset();		/**< Forget the values added */
+    void add(double x);		/**< Add a value. The negative ones are counted in the first bin */
+
+    long long count() const { return n; }	/**< Return the number of values added */
+    double mean() const;
+    double stddev() const;
+    double min() const { return low; }		/**< Return the smallest value added */
+    double max() const { return high; }		/**< Return the largest value added */
+
+
+    /**
+     * @brief Return the percentile of the values added (upper edge of its bin)
+     *
+     * @param q Percentile in the range [0, 1], e.g. 0.99
+     * @return double The percentile; the largest value if it falls in the overflow bin; 0 if no value has been added
+     */
+    double percentile(double q) const;
+
+    double bin_width() const { return width; }	/**< Return the width of a bin */
+    const std::vector<long long>& counts() const { return bins; }	/**< Return the counts of the bins, the last one being the overflow */
+};
+
+#endif // CHISTOGRAM_H
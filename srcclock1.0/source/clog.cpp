@@ -17,13 +17,233 @@
 */
 
 
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
 #include "clog.h"
 
+
+#define LINE		4096	// bytes of a record queued even without the end of line
+#define IDLE		5	// ms slept by the writer when the rings are empty
+
+
+
+/* Ring of the records of a thread. head and tail count the bytes queued and written since the creation, so the free
+   space is size - (head - tail). Each record is a header followed by its text, wrapping around the end of the buffer.
+   The rings are never deleted: the ring of a thread that has exited is reused by the next thread, so its address
+   stays valid for the writer and for sync().
+*/
+struct Clog::Cring {
+  struct Cheader {
+    Clog* log;
+    size_t length;
+  };
+
+  std::vector<char> data;
+  size_t size;
+  std::atomic<size_t> head;	// written by the thread logging only
+  std::atomic<size_t> tail;	// written by the writer only
+  std::atomic<long long> dropped;
+  long long reported;		// records dropped already noted by the writer
+  std::atomic<bool> closed;	// the thread logging has exited
+
+  Cring(size_t bytes) : data(bytes), size(bytes), head(0), tail(0), dropped(0), reported(0), closed(false) {}
+
+  void put(Clog* log, const char* s, size_t n)
+  {
+    const size_t h = head.load(std::memory_order_relaxed);
+    const Cheader header = {log, n};
+
+    if(sizeof(header) + n > size - (h - tail.load(std::memory_order_acquire))) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    copy_in(h, &header, sizeof(header));
+    copy_in(h + sizeof(header), s, n);
+    head.store(h + sizeof(header) + n, std::memory_order_release);
+  }
+
+  void copy_in(size_t pos, const void* s, size_t n)
+  {
+    const size_t p = pos % size;
+    const size_t first = std::min(n, size - p);
+
+    memcpy(&data[p], s, first);
+    memcpy(&data[0], (const char*)s + first, n - first);
+  }
+
+  void copy_out(size_t pos, void* s, size_t n) const
+  {
+    const size_t p = pos % size;
+    const size_t first = std::min(n, size - p);
+
+    memcpy(s, &data[p], first);
+    memcpy((char*)s + first, &data[0], n - first);
+  }
+};
+
+
+
+/* Background thread writing the records of all the logs in asyncronous mode. The streams are flushed after each pass
+   over the rings, before the space of the records is given back, so sync() returns with the records on the streams.
+*/
+class Clog::Cwriter {
+    struct Cholder {		// ring of a thread, released when the thread exits
+      Cring* ring;
+      Cholder() : ring(NULL) {}
+      ~Cholder() { if(ring) ring->closed = true; }
+    };
+
+    std::vector<Cring*> rings;
+    std::mutex mutex;		// guards rings, size and the start
+    std::thread thread;
+    std::atomic<bool> running;
+    size_t size;
+    static thread_local Cholder holder;
+
+public:
+    Cwriter() : running(false), size(ASYNC_RING) {}
+
+    ~Cwriter()
+    {
+      running = false;
+      if(thread.joinable()) thread.join();
+      for(size_t i = 0; i < rings.size(); i++) delete rings[i];
+    }
+
+    static Cwriter& instance()
+    {
+      static Cwriter writer;
+      return writer;
+    }
+
+    void start()
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      if(thread.joinable()) return;
+
+      running = true;
+      thread = std::thread(&Cwriter::run, this);
+    }
+
+    void set_size(size_t bytes)
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      size = bytes;
+    }
+
+    Cring* ring()		// ring of the calling thread
+    {
+      if(holder.ring) return holder.ring;
+
+      std::unique_lock<std::mutex> lock(mutex);
+      for(size_t i = 0; i < rings.size(); i++) {
+        Cring* r = rings[i];
+        if(r->closed && (r->size == size) && (r->tail.load() == r->head.load())) {
+          r->closed = false;
+          return holder.ring = r;
+        }
+      }
+      rings.push_back(new Cring(size));
+      return holder.ring = rings.back();
+    }
+
+    void sync()
+    {
+      std::vector<std::pair<Cring*, size_t> > marks;
+      bool done;
+
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        if(!thread.joinable()) return;
+        for(size_t i = 0; i < rings.size(); i++) marks.push_back(std::make_pair(rings[i], rings[i]->head.load(std::memory_order_acquire)));
+      }
+
+      do {
+        done = true;
+        for(size_t i = 0; i < marks.size(); i++)
+          if(marks[i].first->tail.load(std::memory_order_acquire) < marks[i].second) done = false;
+        if(!done) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      } while(done == false);
+    }
+
+    long long dropped()
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      long long n = 0;
+
+      for(size_t i = 0; i < rings.size(); i++) n += rings[i]->dropped.load(std::memory_order_relaxed);
+      return n;
+    }
+
+private:
+    void run()
+    {
+      while(running)
+        if(!drain()) std::this_thread::sleep_for(std::chrono::milliseconds(IDLE));
+      while(drain()) ;		// the last records
+    }
+
+    bool drain()
+    {
+      std::vector<Cring*> list;
+      std::vector<size_t> tails;
+      std::vector<Clog*> logs;	// written in this pass
+      Cring::Cheader header;
+      std::string text;
+      bool any = false;
+
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        list = rings;
+      }
+
+      for(size_t i = 0; i < list.size(); i++) {
+        Cring& r = *list[i];
+        const size_t h = r.head.load(std::memory_order_acquire);
+        size_t t = r.tail.load(std::memory_order_relaxed);
+
+        while(t < h) {
+          const long long d = r.dropped.load(std::memory_order_relaxed);
+
+          r.copy_out(t, &header, sizeof(header));
+          text.resize(header.length);
+          if(header.length > 0) r.copy_out(t + sizeof(header), &text[0], header.length);
+          t += sizeof(header) + header.length;
+
+          if(d > r.reported) {	// the note goes where the lost records would have gone, most likely
+            const std::string note = "[" + std::to_string(d - r.reported) + " log records dropped]\n";
+            header.log->write(note.data(), note.size());
+            r.reported = d;
+          }
+          header.log->write(text.data(), text.size());
+          if(std::find(logs.begin(), logs.end(), header.log) == logs.end()) logs.push_back(header.log);
+          any = true;
+        }
+        tails.push_back(t);
+      }
+
+      for(size_t i = 0; i < logs.size(); i++) logs[i]->flushStream();
+      for(size_t i = 0; i < list.size(); i++) list[i]->tail.store(tails[i], std::memory_order_release);
+
+      return any;
+    }
+};
+
+thread_local Clog::Cwriter::Cholder Clog::Cwriter::holder;
+
+
 Clog::Clog()
 : fout()
 {
   mode = 1;	// normal stream
   errorStream = false;
+  async = false;
 }
 
 Clog::Clog(bool ErrorMode)
@@ -31,6 +251,7 @@ Clog::Clog(bool ErrorMode)
 {
   mode = 1;
   errorStream = ErrorMode;
+  async = false;
 }
 
 Clog::Clog(const char* filename, bool ErrorMode)
@@ -40,10 +261,12 @@ Clog::Clog(const char* filename, bool ErrorMode)
   else mode = 1;
   
   errorStream = ErrorMode;
+  async = false;
 }
 
 bool Clog::streamOnFile(const char* filename)
 {
+  if(async) flush().sync();	// the records queued go to the old stream
   if(mode == 2) fout.close();
   
   fout.open(filename, std::ios_base::out);
@@ -55,6 +278,7 @@ bool Clog::streamOnFile(const char* filename)
 
 void Clog::streamOnSTDOUT()
 {
+  if(async) flush().sync();
   if(mode == 2) {
     fout.close();
     mode = 1;
@@ -81,6 +305,8 @@ bool Clog::good() const
 
 Clog& Clog::operator<<(const std::string& s)
 {
+  if(async) return append(s.data(), s.size());
+
   switch(mode) {
     case 1: if(errorStream) std::cerr <<s;
 	    else std::cout <<s;
@@ -94,6 +320,8 @@ Clog& Clog::operator<<(const std::string& s)
 
 Clog& Clog::operator<<(const char* s)
 {
+  if(async) return append(s, strlen(s));
+
   switch(mode) {
     case 1: if(errorStream) std::cerr <<s;
 	    else std::cout <<s;
@@ -107,6 +335,8 @@ Clog& Clog::operator<<(const char* s)
 
 Clog& Clog::operator<<(char s)
 {
+  if(async) return append(&s, 1);
+
   switch(mode) {
     case 1: if(errorStream) std::cerr <<s;
 	    else std::cout <<s;
@@ -120,6 +350,10 @@ Clog& Clog::operator<<(char s)
 
 Clog& Clog::operator<<(int s)
 {
+  char buffer[32];
+
+  if(async) return append(buffer, snprintf(buffer, sizeof(buffer), "%d", s));
+
   switch(mode) {
     case 1: if(errorStream) std::cerr <<s;
 	    else std::cout <<s;
@@ -133,6 +367,10 @@ Clog& Clog::operator<<(int s)
 
 Clog& Clog::operator<<(long int s)
 {
+  char buffer[32];
+
+  if(async) return append(buffer, snprintf(buffer, sizeof(buffer), "%ld", s));
+
   switch(mode) {
     case 1: if(errorStream) std::cerr <<s;
 	    else std::cout <<s;
@@ -147,6 +385,10 @@ Clog& Clog::operator<<(long int s)
 
 Clog& Clog::operator<<(long long int s)
 {
+  char buffer[32];
+
+  if(async) return append(buffer, snprintf(buffer, sizeof(buffer), "%lld", s));
+
   switch(mode) {
     case 1: if(errorStream) std::cerr <<s;
 	    else std::cout <<s;
@@ -160,6 +402,10 @@ Clog& Clog::operator<<(long long int s)
 
 Clog& Clog::operator<<(double s)
 {
+  char buffer[32];
+
+  if(async) return append(buffer, snprintf(buffer, sizeof(buffer), "%g", s));	// as the default format of the streams
+
   switch(mode) {
     case 1: if(errorStream) std::cerr <<s;
 	    else std::cout <<s;
@@ -173,6 +419,7 @@ Clog& Clog::operator<<(double s)
 
 void Clog::closeFile()
 {
+  if(async) flush().sync();
   if(mode == 2)
     fout.close();
   mode = 1;
@@ -181,19 +428,85 @@ void Clog::closeFile()
 
 Clog::~Clog()
 {
+  if(async) flush().sync();	// the writer must not see the object destroyed
   if(mode == 2)
     fout.close();
 }
 
 Clog& Clog::flush()
+{
+  if(async) {			// the text logged so far is queued, the writer flushes the stream
+    if(!line.empty()) push();
+    return *this;
+  }
+
+  flushStream();
+  
+  return *this;
+}
+
+
+
+void Clog::setAsync(bool on)
+{
+  if(async && !on) flush().sync();
+  async = on;
+  if(async) Cwriter::instance().start();
+}
+
+
+void Clog::setRingSize(size_t bytes)
+{
+  Cwriter::instance().set_size((bytes > 0) ? bytes : ASYNC_RING);
+}
+
+
+void Clog::sync()
+{
+  Cwriter::instance().sync();
+}
+
+
+long long Clog::dropped()
+{
+  return Cwriter::instance().dropped();
+}
+
+
+Clog& Clog::append(const char* s, size_t n)
+{
+  line.append(s, n);
+  if((memchr(s, '\n', n) != NULL) || (line.size() >= LINE)) push();
+
+  return *this;
+}
+
+
+void Clog::push()
+{
+  Cwriter::instance().ring()->put(this, line.data(), line.size());
+  line.clear();
+}
+
+
+void Clog::write(const char* s, size_t n)
+{
+  switch(mode) {
+    case 1: if(errorStream) std::cerr.write(s, n);
+	    else std::cout.write(s, n);
+	    break;
+    case 2: fout.write(s, n);
+	    break;
+  }
+}
+
+
+void Clog::flushStream()
 {
   if(mode == 1) {
     if(errorStream) std::cerr.flush();
     else  std::cout.flush();
   }
   else  fout.flush();
-
-  
-  return *this;
 }
 
@@ -23,12 +23,24 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <cstddef>
+
+
+#define ASYNC_RING	262144	// default bytes of the ring of each thread in asyncronous mode
 
 
 
 /**
   * @brief Manage the outputs and logs. It is possible to redirect the output messages (normal and/or errors) to standard output or file.
   *
+  * In asyncronous mode the messages are formatted in memory and each line (or the text logged before a flush()) is
+  * queued as a record on a ring of the calling thread, one producer and one consumer without locks. A background
+  * thread, shared by all the logs, drains the rings and writes the records on their streams, so the thread logging
+  * never waits for the I/O. The memory is bounded: a record not fitting the free space of its ring is dropped and
+  * counted, and a note of the records dropped precedes the next record written. The records of a thread keep their
+  * order; the records reach the streams a few ms later, after the outputs written directly on them. A log in
+  * asyncronous mode is used by one thread at a time, as the streams are.
+  *
   * @class Clog
   * @author Vittorio Tornielli di Crestvolant   <vittorio.tornielli@gmail.com>
   * @version 1.0
@@ -36,9 +48,14 @@
   */
 
 class Clog {
+    struct Cring;		// ring of the records of a thread
+    class Cwriter;		// background thread writing the records
+
     std::ofstream fout;
     int mode;
     bool errorStream;
+    bool async;
+    std::string line;		// record being formatted in asyncronous mode
     
 public:
     Clog();
@@ -55,6 +72,12 @@ public:
     bool good() const;
     
     Clog& flush();
+
+    void setAsync(bool on);	/**< Queue the messages to the background writer instead of writing them (see above) */
+    bool isAsync() const { return async; }
+    static void setRingSize(size_t bytes);	/**< Bytes of the rings of the threads logging for the first time from now on */
+    static void sync();		/**< Wait until the records queued so far by every thread have been written */
+    static long long dropped();	/**< Return the records dropped since the start for lack of space */
     
     Clog& operator<<(const std::string& s);
     Clog& operator<<(const char* s);
@@ -65,6 +88,12 @@ public:
     Clog& operator<<(long long int s);
     
     virtual ~Clog();
+
+private:
+    Clog& append(const char* s, size_t n);	// formats in line, queued at the end of a line
+    void push();		// queues line as a record
+    void write(const char* s, size_t n);	// writes on the stream
+    void flushStream();
 };
 
 #endif // CLOG_H
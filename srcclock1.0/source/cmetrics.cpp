@@ -0,0 +1,325 @@
+/*
+    Class Cmetrics - Implementation.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <sstream>
+#include <fstream>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "cmetrics.h"
+#include "cdecoder.h"
+
+
+#define POLL		200	// ms between the checks of the stop of the socket thread
+#define REQUEST		100	// ms waited for the request of a client
+#define BACKLOG		4	// connections waiting to be served
+
+
+
+Cmetrics::Cmetrics()
+{
+  values.frames = values.syncs = 0;
+  for(int i = 0; i < STATS_ERRORS; i++) values.failures[i] = 0;
+  values.timeouts[0] = values.timeouts[1] = 0;
+  values.threshold = values.noise = values.offset = values.tick = NAN;
+  values.decoded = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  shared = values;
+  count = 0;
+
+  listener = -1;
+  period = 0.0;
+  running = false;
+}
+
+Cmetrics::~Cmetrics()
+{
+  close_all();
+}
+
+
+
+bool Cmetrics::open_socket(const char* socket_path)
+{
+  sockaddr_un addr;
+  struct stat st;
+
+  close_all();
+  if((socket_path == NULL) || (strlen(socket_path) >= sizeof(addr.sun_path))) return false;
+
+  if((lstat(socket_path, &st) == 0) && S_ISSOCK(st.st_mode)) unlink(socket_path);	// left by a previous run
+
+  listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(listener < 0) return false;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+  if((bind(listener, (const sockaddr*)&addr, sizeof(addr)) < 0) || (listen(listener, BACKLOG) < 0)) {
+    close(listener);
+    listener = -1;
+    return false;
+  }
+
+  path = socket_path;
+  running = true;
+  exporter = std::thread(&Cmetrics::serve, this);
+
+  return true;
+}
+
+
+bool Cmetrics::open_file(const char* file_path, double seconds)
+{
+  close_all();
+  if((file_path == NULL) || (seconds <= 0.0)) return false;
+
+  path = file_path;
+  period = seconds;
+  if(!write_file()) {
+    period = 0.0;
+    return false;
+  }
+
+  running = true;
+  exporter = std::thread(&Cmetrics::rewrite, this);
+
+  return true;
+}
+
+
+bool Cmetrics::open(const char* spec)
+{
+  std::string s(spec ? spec : "");
+  const size_t comma = s.rfind(',');
+  double seconds = 15.0;
+
+  if(s.compare(0, 5, "unix:") == 0) return open_socket(s.c_str() + 5);
+
+  if(comma != std::string::npos) {
+    seconds = atof(s.c_str() + comma + 1);
+    s.erase(comma);
+  }
+
+  return !s.empty() && open_file(s.c_str(), seconds);
+}
+
+
+void Cmetrics::close_all()
+{
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    running = false;
+  }
+  stop_cv.notify_all();
+  if(exporter.joinable()) exporter.join();
+
+  if(listener >= 0) {
+    close(listener);
+    unlink(path.c_str());
+  }
+  listener = -1;
+
+  if(period > 0.0) write_file();	// the last state of the decoder
+  period = 0.0;
+}
+
+
+
+void Cmetrics::event(int type, int value, double power, double threshold, double noise)
+{
+  switch(type) {
+    case EVENT_FRAME:	values.frames++;
+			values.decoded = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+			break;
+    case EVENT_RESET:	values.failures[((value > 0) && (value < STATS_ERRORS)) ? value : 0]++;
+			break;
+    case EVENT_TICK:	values.tick = 10*log10(power);
+			break;
+    case EVENT_SYNC:	values.syncs++;
+			break;
+    case EVENT_TIMEOUT:	values.timeouts[value ? 1 : 0]++;
+			break;
+    default:		break;
+  }
+
+  values.threshold = 10*log10(threshold);
+  values.noise = (noise > 0.0) ? 10*log10(noise) : NAN;
+
+  publish();
+}
+
+
+void Cmetrics::sync(double offset)
+{
+  values.offset = offset;
+}
+
+
+
+// The copy is written between two increments of count: a reader finding count odd, or changed, reads it again
+void Cmetrics::publish()
+{
+  count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  shared = values;
+  count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+
+Cmetrics_values Cmetrics::read() const
+{
+  Cmetrics_values v;
+  unsigned before, after;
+
+  while(true) {
+    before = count.load(std::memory_order_acquire);
+    v = shared;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    after = count.load(std::memory_order_relaxed);
+    if(((before & 1) == 0) && (before == after)) return v;
+
+    std::this_thread::yield();		// the decoder is writing the copy
+  }
+}
+
+
+
+std::string Cmetrics::text() const
+{
+  const Cmetrics_values v = read();
+  const long long now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  std::ostringstream out;
+
+  out <<"# HELP srcclock_frames_decoded_total Frames decoded.\n"
+      <<"# TYPE srcclock_frames_decoded_total counter\n"
+      <<"srcclock_frames_decoded_total " <<v.frames <<'\n'
+      <<"# HELP srcclock_frames_failed_total Acquisitions of the frame restarted, by error code of the checks.\n"
+      <<"# TYPE srcclock_frames_failed_total counter\n";
+  for(int i = 1; i < STATS_ERRORS; i++) out <<"srcclock_frames_failed_total{error=\"" <<i <<"\"} " <<v.failures[i] <<'\n';
+  out <<"srcclock_frames_failed_total{error=\"other\"} " <<v.failures[0] <<'\n'
+      <<"# HELP srcclock_timeouts_total Timeouts of the decoding, by stage.\n"
+      <<"# TYPE srcclock_timeouts_total counter\n"
+      <<"srcclock_timeouts_total{stage=\"frame\"} " <<v.timeouts[0] <<'\n'
+      <<"srcclock_timeouts_total{stage=\"sync\"} " <<v.timeouts[1] <<'\n'
+      <<"# HELP srcclock_syncs_total Minutes syncronised with the RP.\n"
+      <<"# TYPE srcclock_syncs_total counter\n"
+      <<"srcclock_syncs_total " <<v.syncs <<'\n'
+      <<"# HELP srcclock_decision_threshold_db Decision threshold of the symbols.\n"
+      <<"# TYPE srcclock_decision_threshold_db gauge\n"
+      <<"srcclock_decision_threshold_db " <<number(v.threshold) <<'\n'
+      <<"# HELP srcclock_noise_floor_db Noise level of the Window Decision System.\n"
+      <<"# TYPE srcclock_noise_floor_db gauge\n"
+      <<"srcclock_noise_floor_db " <<number(v.noise) <<'\n'
+      <<"# HELP srcclock_sync_offset_seconds Syncronisation offset of the last minute syncronised.\n"
+      <<"# TYPE srcclock_sync_offset_seconds gauge\n"
+      <<"srcclock_sync_offset_seconds " <<number(v.offset) <<'\n'
+      <<"# HELP srcclock_tick_power_db Power of the last RP received.\n"
+      <<"# TYPE srcclock_tick_power_db gauge\n"
+      <<"srcclock_tick_power_db " <<number(v.tick) <<'\n'
+      <<"# HELP srcclock_seconds_since_last_decode Seconds since the last frame decoded (since the start if none).\n"
+      <<"# TYPE srcclock_seconds_since_last_decode gauge\n"
+      <<"srcclock_seconds_since_last_decode " <<number((now - v.decoded)*1e-9) <<'\n';
+
+  return out.str();
+}
+
+
+std::string Cmetrics::number(double x)
+{
+  char s[32];
+
+  if(std::isnan(x)) return "NaN";
+  if(std::isinf(x)) return (x > 0) ? "+Inf" : "-Inf";
+
+  snprintf(s, sizeof(s), "%.9g", x);
+  return s;
+}
+
+
+
+void Cmetrics::serve()
+{
+  pollfd p;
+  char request[1024];
+  std::string body, reply;
+  int client, n;
+
+  while(true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      if(!running) return;
+    }
+
+    p.fd = listener;
+    p.events = POLLIN;
+    if(poll(&p, 1, POLL) <= 0) continue;
+
+    client = accept(listener, NULL, NULL);
+    if(client < 0) continue;
+
+    p.fd = client;		// a request is read if any, so an HTTP client gets an HTTP response
+    p.events = POLLIN;
+    n = (poll(&p, 1, REQUEST) > 0) ? recv(client, request, sizeof(request) - 1, MSG_DONTWAIT) : 0;
+
+    body = text();
+    if((n >= 4) && (strncmp(request, "GET ", 4) == 0)) {
+      reply = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+    }
+    else reply = body;
+
+    send(client, reply.data(), reply.size(), MSG_NOSIGNAL);
+    close(client);
+  }
+}
+
+
+void Cmetrics::rewrite()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+
+  while(running) {
+    if(stop_cv.wait_for(lock, std::chrono::duration<double>(period), [this]() { return !running; })) return;
+
+    lock.unlock();
+    write_file();
+    lock.lock();
+  }
+}
+
+
+bool Cmetrics::write_file() const
+{
+  const std::string tmp = path + ".tmp";
+  std::ofstream f(tmp.c_str());
+
+  f <<text();
+  f.close();
+  if(!f) {
+    unlink(tmp.c_str());
+    return false;
+  }
+
+  return rename(tmp.c_str(), path.c_str()) == 0;
+}
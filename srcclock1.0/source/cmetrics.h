@@ -0,0 +1,136 @@
+/*
+    Class Cmetrics - Part of the SRCclock program.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CMETRICS_H
+#define CMETRICS_H
+
+
+#include <string>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include "cstats.h"
+
+
+
+/**
+ * @brief Health of a decoder published by Cmetrics
+ */
+struct Cmetrics_values {
+  long long frames;		/**< Frames decoded */
+  long long failures[STATS_ERRORS];	/**< Acquisitions of the frame restarted, by error code of Csrc::check(). failures[0] counts the codes out of range */
+  long long timeouts[2];	/**< Timeouts while acquiring the frame and while waiting for the RP */
+  long long syncs;		/**< Minutes syncronised */
+  double threshold;		/**< Decision threshold in dB */
+  double noise;			/**< Noise level of the Window Decision System in dB. NaN before the first symbol */
+  double offset;		/**< Syncronisation offset of the last minute syncronised in s. NaN before the first one */
+  double tick;			/**< Power of the last RP in dB. NaN before the first one */
+  long long decoded;		/**< steady_clock time of the last frame decoded in ns (of the start of the metrics before the first one) */
+};
+
+
+
+/**
+ * @brief Health of the decoder exported in the Prometheus text format, for the long running decoders.
+ *
+ * The thread of the decoder updates the metrics at each event (see Cdecoder) and publishes a copy of them as the SHM
+ * refclock does: a counter is incremented before and after writing the copy, so a reader detects a copy read while it
+ * was being written and reads it again. The decoder never waits for the readers. A thread of the object exports the
+ * copy, either on a Unix stream socket (each connection gets the metrics, as an HTTP response if it sends a GET
+ * request, e.g. curl --unix-socket PATH http://localhost/metrics) or rewriting a file every few seconds: the metrics
+ * are written on PATH.tmp and renamed to PATH, so the readers (e.g. the textfile collector of node_exporter) always
+ * find a whole file. Only one decoder may update an object.
+ *
+ * @class Cmetrics
+ * @author Vittorio Tornielli di Crestvolant   <vittorio.tornielli@gmail.com>
+ * @version 1.0
+ * @date 2009-2014
+ */
+
+class Cmetrics {
+    Cmetrics_values values;	// updated by the thread of the decoder only
+    Cmetrics_values shared;	// copy published to the exporter
+    std::atomic<unsigned> count;	// odd while shared is being written
+
+    int listener;		// listening socket. -1 if none
+    std::string path;		// socket or file
+    double period;		// seconds between the rewritings of the file. 0 = no file
+    std::thread exporter;
+    bool running;
+    std::mutex mutex;
+    std::condition_variable stop_cv;
+
+public:
+    Cmetrics();
+    ~Cmetrics();
+
+
+    /**
+     * @brief Serve the metrics on a Unix stream socket, created (replacing an old socket) and served by a thread
+     *
+     * @param socket_path Path of the socket
+     * @return bool false if the socket cannot be created
+     */
+    bool open_socket(const char* socket_path);
+
+
+    /**
+     * @brief Rewrite the metrics on a file from a thread, renaming a temporary file (PATH.tmp) each time
+     *
+     * @param file_path Path of the file
+     * @param seconds Seconds between the rewritings
+     * @return bool false if the file cannot be written
+     */
+    bool open_file(const char* file_path, double seconds = 15.0);
+
+
+    /**
+     * @brief Open the output described by spec: "unix:PATH" for open_socket(), "PATH[,SECONDS]" for open_file()
+     */
+    bool open(const char* spec);
+
+    void close_all();		/**< Stop the thread, close the socket (removing it) and write the file a last time */
+    bool is_open() const { return exporter.joinable(); }	/**< Return true if an output is open */
+
+
+    /**
+     * @brief Count an event of the decoder and publish the metrics. Called by the thread of the decoder
+     *
+     * @param type Type of the event (Cevent_type)
+     * @param value Value of the event (see Cevent_type)
+     * @param power Power of the event (the RP of EVENT_TICK)
+     * @param threshold Current decision threshold (power)
+     * @param noise Current noise level of the WDS (power). 0 if unknown
+     */
+    void event(int type, int value, double power, double threshold, double noise);
+    void sync(double offset);	/**< Set the syncronisation offset in s of the minute being syncronised, published by its EVENT_SYNC */
+
+    Cmetrics_values read() const;	/**< Return the last metrics published. Any thread */
+    std::string text() const;	/**< Return the last metrics published in the Prometheus text format. Any thread */
+
+private:
+    void publish();
+    void serve();		// thread of the socket
+    void rewrite();		// thread of the file
+    bool write_file() const;
+    static std::string number(double x);	// number in the Prometheus format
+};
+
+#endif // CMETRICS_H
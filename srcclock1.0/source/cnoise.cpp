@@ -0,0 +1,124 @@
+/*
+    Class Cnoise - Implementation.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <iterator>
+#include "cnoise.h"
+
+
+
+Cnoise::Cnoise()
+{
+  set(NOISE_MEAN, 50);
+}
+
+
+void Cnoise::set(int estimator, int symbols, double percentile)
+{
+  type = ((estimator >= NOISE_MEAN) && (estimator <= NOISE_PERCENTILE)) ? estimator : NOISE_MEAN;
+  length = (symbols > 0) ? symbols : 1;
+  q = percentile;
+  if((q <= 0.0) || (q >= 1.0)) q = 0.5;
+
+  reset();
+}
+
+
+void Cnoise::reset()
+{
+  window.assign(length, 0.0);
+  pos = 0;
+  count = 0;
+  sum = 0.0;
+  ewma = 0.0;
+  low.clear();
+  high.clear();
+}
+
+
+
+void Cnoise::add(double x)
+{
+  const double old = window[pos];
+  const bool full = (count >= length);
+
+  window[pos] = x;
+  pos = (pos + 1) % length;
+  count++;
+
+  switch(type) {
+    case NOISE_EWMA:	ewma = (count == 1) ? x : ewma + (x - ewma)*2.0/(length + 1);
+			break;
+
+    case NOISE_PERCENTILE:
+			if(full) {	// the oldest symbol leaves the window
+			  if(!low.empty() && (old <= *low.rbegin())) low.erase(low.find(old));
+			  else high.erase(high.find(old));
+			}
+			if(!low.empty() && (x <= *low.rbegin())) low.insert(x);
+			else high.insert(x);
+			balance();
+			break;
+
+    default:		if(pos == 0) {	// the running sum is computed again once for each window, so the rounding errors do not pile up
+			  sum = 0.0;
+			  for(int i = 0; i < length; i++) sum += window[i];
+			}
+			else sum += x - old;
+  }
+}
+
+
+// low keeps the elements up to the percentile, so its greatest one is the estimate
+void Cnoise::balance()
+{
+  const size_t n = low.size() + high.size();
+  const size_t k = size_t(q*(n - 1)) + 1;
+
+  while(low.size() > k) {
+    high.insert(*low.rbegin());
+    low.erase(std::prev(low.end()));
+  }
+  while((low.size() < k) && !high.empty()) {
+    low.insert(*high.begin());
+    high.erase(high.begin());
+  }
+}
+
+
+
+double Cnoise::estimate() const
+{
+  const long long n = (count < length) ? count : length;
+
+  if(count == 0) return 0.0;
+
+  switch(type) {
+    case NOISE_EWMA:		return ewma;
+    case NOISE_PERCENTILE:	return *low.rbegin();
+    default:			return sum/n;
+  }
+}
+
+
+const char* Cnoise::name() const
+{
+  const char* names[] = {"mean", "EWMA", "percentile"};
+
+  return names[type];
+}
@@ -0,0 +1,91 @@
+/*
+    Class Cnoise - Part of the SRCclock program.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CNOISE_H
+#define CNOISE_H
+
+
+#include <vector>
+#include <set>
+
+
+
+/**
+ * @brief Estimators of the noise level available to the Window Decision System
+ */
+enum Cnoise_type {
+  NOISE_MEAN,		/**< Mean of the last symbols (running sum) */
+  NOISE_EWMA,		/**< Exponentially weighted moving average, with the same memory of the window */
+  NOISE_PERCENTILE	/**< Percentile (e.g. the median) of the last symbols */
+};
+
+
+
+/**
+ * @brief Running estimate of the noise level over the last symbols, updated symbol by symbol.
+ *
+ * The mean is kept as a running sum and the EWMA as a single value, so each update costs the same whatever the length
+ * of the window. The percentile keeps the last symbols sorted in two sets, the ones below and the ones above the
+ * percentile, and costs O(log length) for each update. Unlike the mean it is not raised by the few loud symbols of a
+ * burst of program audio. Being the power of the noise skewed, its median is lower than its mean (about 0.84 times
+ * for white noise), so the SNR level of the WDS may be raised by about 1 dB.
+ *
+ * @class Cnoise
+ * @author Vittorio Tornielli di Crestvolant   <vittorio.tornielli@gmail.com>
+ * @version 1.0
+ * @date 2009-2014
+ */
+
+class Cnoise {
+    int type;
+    int length;			// symbols of the window
+    double q;			// percentile in (0, 1)
+    std::vector<double> window;	// last symbols, in order of arrival
+    int pos;			// next element of the window to be replaced
+    long long count;		// symbols added since the reset
+    double sum;			// running sum of the window
+    double ewma;
+    std::multiset<double> low, high;	// window split by the percentile: every element of low is <= the ones of high
+
+public:
+    Cnoise();
+
+
+    /**
+     * @brief Set the estimator and reset it
+     *
+     * @param estimator One of Cnoise_type
+     * @param symbols Length of the window in symbols
+     * @param percentile Percentile in the range (0, 1) for NOISE_PERCENTILE, e.g. 0.5 for the median
+     */
+    void set(int estimator, int symbols, double percentile = 0.5);
+    void reset();		/**< Forget the symbols added */
+
+    void add(double x);		/**< Add the noise power of a new symbol */
+    double estimate() const;	/**< Return the noise level of the last symbols */
+
+    long long size() const { return count; }	/**< Return the number of symbols added since the reset */
+    int get_type() const { return type; }	/**< Return the estimator (Cnoise_type) */
+    const char* name() const;	/**< Return the name of the estimator */
+
+private:
+    void balance();
+};
+
+#endif // CNOISE_H
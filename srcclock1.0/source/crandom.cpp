@@ -0,0 +1,210 @@
+/*
+    Class Crandom - Implementation.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cmath>
+#include <random>
+#include "crandom.h"
+
+
+#define ZIG_LAYERS	128
+#define ZIG_R		3.442619855899		// start of the tail
+#define ZIG_V		9.91256303526217e-3	// area of each layer
+
+
+
+// layers of the Ziggurat: x[i] is the right edge of the layer i, r[i] = x[i+1]/x[i] the part of the layer inside the
+// curve for sure. Computed once (the initialisation of a local static is thread safe)
+namespace {
+struct Cziggurat {
+  double x[ZIG_LAYERS + 1];
+  double r[ZIG_LAYERS];
+
+  Cziggurat() {
+    double f = exp(-0.5*ZIG_R*ZIG_R);
+
+    x[0] = ZIG_V/f;		// the base layer, with the tail, as a rectangle of the same area
+    x[1] = ZIG_R;
+    x[ZIG_LAYERS] = 0.0;
+    for(int i = 2; i < ZIG_LAYERS; i++) {
+      x[i] = sqrt(-2.0*log(ZIG_V/x[i - 1] + f));
+      f = exp(-0.5*x[i]*x[i]);
+    }
+    for(int i = 0; i < ZIG_LAYERS; i++) r[i] = x[i + 1]/x[i];
+  }
+};
+
+const Cziggurat& ziggurat()
+{
+  static const Cziggurat z;
+  return z;
+}
+
+inline uint64_t rotl(uint64_t x, int k)
+{
+  return (x << k) | (x >> (64 - k));
+}
+
+inline uint64_t splitmix64(uint64_t& x)
+{
+  uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+  z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27))*0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+}
+
+
+
+Crandom::Crandom()
+{
+  seed(device_seed());
+}
+
+Crandom::Crandom(uint64_t value, unsigned int stream)
+{
+  seed(value, stream);
+}
+
+
+void Crandom::seed(uint64_t value, unsigned int stream)
+{
+  for(int i = 0; i < 4; i++) s[i] = splitmix64(value);
+  for(unsigned int k = 0; k < stream; k++) jump();
+}
+
+
+uint64_t Crandom::device_seed()
+{
+  std::random_device device;
+
+  return (uint64_t(device()) << 32) ^ device();
+}
+
+
+
+uint64_t Crandom::next()
+{
+  const uint64_t result = rotl(s[1]*5, 7)*9;
+  const uint64_t t = s[1] << 17;
+
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rotl(s[3], 45);
+
+  return result;
+}
+
+
+void Crandom::jump()
+{
+  static const uint64_t JUMP[] = { 0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa, 0x39abdc4529b1661c };
+  uint64_t t[4] = {0, 0, 0, 0};
+
+  for(int i = 0; i < 4; i++)
+    for(int b = 0; b < 64; b++) {
+      if(JUMP[i] & (uint64_t(1) << b))
+        for(int j = 0; j < 4; j++) t[j] ^= s[j];
+      next();
+    }
+
+  for(int j = 0; j < 4; j++) s[j] = t[j];
+}
+
+
+// the 53 upper bits, centred in their interval so 0 is excluded (log() of the tail)
+double Crandom::uniform()
+{
+  return ((next() >> 11) + 0.5)*(1.0/9007199254740992.0);
+}
+
+
+int Crandom::below(int n)
+{
+  return (n > 0) ? int(((next() >> 32)*uint64_t(n)) >> 32) : 0;
+}
+
+
+
+// one number gives both the layer (7 low bits) and the abscissa (53 high bits, signed)
+double Crandom::gaussian()
+{
+  const Cziggurat& z = ziggurat();
+  const uint64_t r = next();
+  const int i = r & (ZIG_LAYERS - 1);
+  const double u = 2.0*((r >> 11)*(1.0/9007199254740992.0)) - 1.0;
+
+  return (fabs(u) < z.r[i]) ? u*z.x[i] : outside(i, u);
+}
+
+
+// the point is out of the part of the layer surely under the curve: the tail for the base layer, else the wedge
+// between the layer and the curve. Rejected points start again from a new layer
+double Crandom::outside(int i, double u)
+{
+  const Cziggurat& z = ziggurat();
+  const double x = u*z.x[i];
+
+  if(i == 0) {
+    double t, y;
+
+    do {
+      t = log(uniform())/ZIG_R;
+      y = log(uniform());
+    } while(-2.0*y < t*t);
+
+    return (u < 0) ? t - ZIG_R : ZIG_R - t;
+  }
+
+  const double f0 = exp(-0.5*(z.x[i]*z.x[i] - x*x));
+  const double f1 = exp(-0.5*(z.x[i + 1]*z.x[i + 1] - x*x));
+
+  return (f1 + uniform()*(f0 - f1) < 1.0) ? x : gaussian();
+}
+
+
+// as gaussian(), with the layers looked up once for the whole buffer
+void Crandom::fill(float* x, int n, double sigma)
+{
+  const Cziggurat& z = ziggurat();
+
+  for(int k = 0; k < n; k++) {
+    const uint64_t r = next();
+    const int i = r & (ZIG_LAYERS - 1);
+    const double u = 2.0*((r >> 11)*(1.0/9007199254740992.0)) - 1.0;
+
+    x[k] = ((fabs(u) < z.r[i]) ? u*z.x[i] : outside(i, u))*sigma;
+  }
+}
+
+
+void Crandom::add(float* x, int n, double sigma)
+{
+  const Cziggurat& z = ziggurat();
+
+  for(int k = 0; k < n; k++) {
+    const uint64_t r = next();
+    const int i = r & (ZIG_LAYERS - 1);
+    const double u = 2.0*((r >> 11)*(1.0/9007199254740992.0)) - 1.0;
+
+    x[k] += ((fabs(u) < z.r[i]) ? u*z.x[i] : outside(i, u))*sigma;
+  }
+}
@@ -0,0 +1,79 @@
+/*
+    Class Crandom - Part of the SRCclock program.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CRANDOM_H
+#define CRANDOM_H
+
+
+#include <cstdint>
+
+
+
+/**
+ * @brief Random numbers of one stream: uniform and Gaussian deviates, reproducible from a seed.
+ *
+ * The generator is xoshiro256** (Blackman and Vigna): 256 bits of state, period 2^256 - 1, a few ns for each 64 bit
+ * number. The state is filled from the seed by splitmix64, so close seeds give unrelated sequences; the stream number
+ * advances the state by stream jumps of 2^128 numbers, so the streams of the same seed never overlap. Each object
+ * has its own state: threads with their own objects need no locks and a seed gives the same noise whatever the order
+ * of the threads.
+ *
+ * The Gaussian deviates use the Ziggurat method of Marsaglia and Tsang, in the version of Doornik (ZIGNOR, 128 layers):
+ * about 99% of the deviates cost one random number, one comparison and one multiplication, with no logarithm nor
+ * trigonometric function. fill() and add() produce a whole buffer in one call.
+ *
+ * @class Crandom
+ * @author Vittorio Tornielli di Crestvolant   <vittorio.tornielli@gmail.com>
+ * @version 1.0
+ * @date 2009-2014
+ */
+
+class Crandom {
+    uint64_t s[4];		// state of xoshiro256**
+
+public:
+    Crandom();			/**< Generator seeded from the random device of the system */
+    Crandom(uint64_t seed, unsigned int stream = 0);	/**< See seed() */
+
+
+    /**
+     * @brief Restart the generator
+     *
+     * @param value Seed
+     * @param stream Independent stream of the same seed (e.g. the thread or the channel)
+     */
+    void seed(uint64_t value, unsigned int stream = 0);
+
+    void jump();		/**< Advance the state by 2^128 numbers */
+
+    uint64_t next();		/**< Return a random 64 bit number */
+    double uniform();		/**< Return a uniform deviate in (0, 1) */
+    int below(int n);		/**< Return a uniform integer in [0, n) */
+    double gaussian();		/**< Return a standard Gaussian deviate */
+
+    void fill(float* x, int n, double sigma);	/**< Store n Gaussian deviates of standard deviation sigma in x */
+    void add(float* x, int n, double sigma);	/**< Add n Gaussian deviates of standard deviation sigma to x */
+
+    static uint64_t device_seed();		/**< Return a seed from the random device of the system */
+
+private:
+    double outside(int i, double u);	// deviate of a point out of the rectangle of the layer i
+};
+
+#endif // CRANDOM_H
@@ -0,0 +1,165 @@
+/*
+    Class Crefclock - Implementation.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "crefclock.h"
+
+
+#define PRECISION	-10	// about 1 ms
+
+
+
+Crefclock::Crefclock()
+{
+  shm = NULL;
+  sock = -1;
+  precision = PRECISION;
+}
+
+Crefclock::~Crefclock()
+{
+  close_all();
+}
+
+
+
+bool Crefclock::open_shm(int unit)
+{
+  const int mode = (unit <= 1) ? 0600 : 0666;
+  int id;
+  void* p;
+
+  if(shm) shmdt((const void*)shm);
+  shm = NULL;
+  if(unit < 0) return false;
+
+  id = shmget(SHM_KEY + unit, sizeof(Cshmtime), IPC_CREAT | mode);
+  if(id < 0) return false;
+
+  p = shmat(id, NULL, 0);
+  if(p == (void*)-1) return false;
+
+  shm = (volatile Cshmtime*)p;
+  shm->valid = 0;
+  shm->mode = 1;
+
+  return true;
+}
+
+
+bool Crefclock::open_sock(const char* socket_path)
+{
+  if(sock >= 0) close(sock);
+  sock = -1;
+  if((socket_path == NULL) || (strlen(socket_path) >= sizeof(((sockaddr_un*)0)->sun_path))) return false;
+
+  sock = socket(AF_UNIX, SOCK_DGRAM, 0);
+  path = socket_path;
+
+  return sock >= 0;
+}
+
+
+void Crefclock::close_all()
+{
+  if(shm) shmdt((const void*)shm);
+  shm = NULL;
+  if(sock >= 0) close(sock);
+  sock = -1;
+}
+
+
+
+bool Crefclock::publish(double clock, double receive, int leap)
+{
+  time_t clock_sec, receive_sec;
+  long clock_ns, receive_ns;
+  int ntp_leap = (leap > 0) ? 1 : ((leap < 0) ? 2 : 0);
+  bool delivered = true;
+
+  split(clock, clock_sec, clock_ns);
+
+  // SRC warns for the end of the month, NTP for the end of the current UTC day
+  tm today, tomorrow;
+  const time_t next = clock_sec + 86400;
+  gmtime_r(&clock_sec, &today);
+  gmtime_r(&next, &tomorrow);
+  if(today.tm_mon == tomorrow.tm_mon) ntp_leap = 0;
+  split(receive, receive_sec, receive_ns);
+
+  if(shm) {
+    shm->valid = 0;
+    shm->count++;
+    __sync_synchronize();	// the reader sees count changed before the sample
+
+    shm->mode = 1;
+    shm->clockTimeStampSec = clock_sec;
+    shm->clockTimeStampUSec = clock_ns/1000;
+    shm->clockTimeStampNSec = clock_ns;
+    shm->receiveTimeStampSec = receive_sec;
+    shm->receiveTimeStampUSec = receive_ns/1000;
+    shm->receiveTimeStampNSec = receive_ns;
+    shm->leap = ntp_leap;
+    shm->precision = precision;
+    shm->nsamples = 1;
+
+    __sync_synchronize();	// and the sample before count changes again
+    shm->count++;
+    shm->valid = 1;
+  }
+
+  if(sock >= 0) {
+    Csocksample s;
+    sockaddr_un addr;
+
+    memset(&s, 0, sizeof(s));
+    s.tv.tv_sec = receive_sec;
+    s.tv.tv_usec = receive_ns/1000;
+    s.offset = clock - receive;
+    s.pulse = 0;
+    s.leap = ntp_leap;
+    s.magic = SOCK_MAGIC;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    if(sendto(sock, &s, sizeof(s), MSG_DONTWAIT, (const sockaddr*)&addr, sizeof(addr)) != sizeof(s)) delivered = false;
+  }
+
+  return delivered;
+}
+
+
+void Crefclock::split(double t, time_t& sec, long& ns)
+{
+  sec = time_t(floor(t));
+  ns = lround((t - sec)*1e9);
+  if(ns >= 1000000000) {
+    ns -= 1000000000;
+    sec++;
+  }
+}
@@ -0,0 +1,135 @@
+/*
+    Class Crefclock - Part of the SRCclock program.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CREFCLOCK_H
+#define CREFCLOCK_H
+
+
+#include <string>
+#include <ctime>
+#include <sys/time.h>
+
+
+#define SHM_KEY		0x4e545030	// key of the SHM segment of the unit 0 ("NTP0")
+#define SOCK_MAGIC	0x534f434b	// magic number of the samples of the SOCK refclock of chrony ("SOCK")
+
+
+
+/**
+ * @brief Segment of the SHM refclock of ntpd and chrony (refclock_shm.c)
+ */
+struct Cshmtime {
+  int mode;			/**< 1: the reader checks count before and after reading */
+  volatile int count;		/**< Incremented by the writer before and after writing the sample */
+  time_t clockTimeStampSec;	/**< True time of the sample */
+  int clockTimeStampUSec;
+  time_t receiveTimeStampSec;	/**< System time of the sample */
+  int receiveTimeStampUSec;
+  int leap;			/**< 0 = no warning, 1 = leap second inserted, 2 = deleted, 3 = not in sync */
+  int precision;		/**< Precision of the sample, as a power of 2 in seconds */
+  int nsamples;
+  volatile int valid;		/**< Set by the writer, cleared by the reader */
+  unsigned clockTimeStampNSec;
+  unsigned receiveTimeStampNSec;
+  int dummy[8];
+};
+
+
+/**
+ * @brief Datagram of the SOCK refclock of chrony (refclock_sock.c)
+ */
+struct Csocksample {
+  struct timeval tv;		/**< System time of the sample */
+  double offset;		/**< True time minus system time */
+  int pulse;			/**< 0: the sample is a time, not a PPS */
+  int leap;			/**< 0 = no warning, 1 = leap second inserted, 2 = deleted */
+  int _pad;
+  int magic;			/**< SOCK_MAGIC */
+};
+
+
+
+/**
+ * @brief Reference clock for ntpd and chrony: each syncronised minute is published as a sample, leaving the filtering
+ *        and the discipline of the system clock to the daemon.
+ *
+ * A sample is a pair of times of the same instant: the true time given by the SRC and the system time at the capture
+ * of that instant (see Csrc::reference_time()). It can be published on the shared memory segment of an NTP SHM unit
+ * (mode 1: the writer increments count before and after the sample, so the reader can detect a sample read while it
+ * was being written) and sent as a datagram to the Unix socket of a chrony SOCK refclock. The socket is created by
+ * chronyd; the datagrams are sent without blocking, so a daemon not running only loses the samples.
+ *
+ * The SHM units 0 and 1 are readable by root only, the following ones by everybody (as in ntpd).
+ *
+ * @class Crefclock
+ * @author Vittorio Tornielli di Crestvolant   <vittorio.tornielli@gmail.com>
+ * @version 1.0
+ * @date 2009-2014
+ */
+
+class Crefclock {
+    volatile Cshmtime* shm;	// segment attached. NULL if none
+    int sock;			// -1 if none
+    std::string path;		// socket of chronyd
+    int precision;
+
+public:
+    Crefclock();
+    ~Crefclock();
+
+
+    /**
+     * @brief Attach the SHM segment of an NTP unit, creating it if needed
+     *
+     * @param unit Unit of the refclock (its key is SHM_KEY + unit)
+     * @return bool false on errors (e.g. permissions)
+     */
+    bool open_shm(int unit);
+
+
+    /**
+     * @brief Send the samples to the socket of a chrony SOCK refclock
+     *
+     * @param socket_path Path of the socket, as in the refclock directive of chronyd
+     * @return bool false if the socket cannot be created
+     */
+    bool open_sock(const char* socket_path);
+
+    void close_all();		/**< Detach the segment and close the socket */
+
+
+    /**
+     * @brief Publish a sample
+     *
+     * @param clock True time of the sample, in seconds since the epoch
+     * @param receive System time of the same instant
+     * @param leap SRC warning of leap second at the end of the month (+1, -1 or 0);
+     *             it is published only on the last day of the month (UTC)
+     * @return bool false if the sample has not been delivered to every output
+     */
+    bool publish(double clock, double receive, int leap = 0);
+
+    void set_precision(int p) { precision = p; }	/**< Precision of the samples as a power of 2 in seconds (default -10, 1 ms) */
+    bool is_open() const { return (shm != NULL) || (sock >= 0); }	/**< Return true if an output is open */
+
+private:
+    static void split(double t, time_t& sec, long& ns);	// seconds and nanoseconds of a time
+};
+
+#endif // CREFCLOCK_H
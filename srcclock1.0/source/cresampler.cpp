@@ -0,0 +1,251 @@
+/*
+    Class Cresampler - Implementation.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cmath>
+#include <cstring>
+#include "cresampler.h"
+#include "csimd.h"
+
+
+#define BLOCK		4096	// input samples added to the history at each step
+#define ATTENUATION	60.0	// stop band attenuation in dB
+#define PASS_BAND	0.375	// edges of the transition band relative to the output frequency
+#define STOP_BAND	0.625
+
+
+
+static int gcd(int a, int b)
+{
+  while(b != 0) {
+    int t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+
+
+Cresampler::Cresampler()
+{
+  set(8000, 8000);
+}
+
+Cresampler::Cresampler(int input_frequency, int output_frequency)
+{
+  set(input_frequency, output_frequency);
+}
+
+
+void Cresampler::set(int input_frequency, int output_frequency)
+{
+  const int g = gcd(input_frequency, output_frequency);
+  const double beta = 0.1102*(ATTENUATION - 8.7);
+  double cutoff, transition, centre, t, sum = 0.0;
+  std::vector<double> h;
+  int taps;
+
+  fin = input_frequency;
+  fout = output_frequency;
+  L = fout/g;
+  M = fin/g;
+
+  // prototype at the rate fin*L; the cutoff is the lower Nyquist frequency
+  if(fout < fin) {
+    cutoff = 0.5*(PASS_BAND + STOP_BAND)*fout/(double(fin)*L);
+    transition = (STOP_BAND - PASS_BAND)*fout/(double(fin)*L);
+  }
+  else {
+    cutoff = 0.5*(PASS_BAND + STOP_BAND)/L;
+    transition = (STOP_BAND - PASS_BAND)/L;
+  }
+
+  taps = int(ceil((ATTENUATION - 8.0)/(2.285*2.0*M_PI*transition))) + 1;	// Kaiser's formula
+  T = (taps + L - 1)/L;
+  T = (T + 7) & ~7;
+
+  h.resize(L*T);
+  centre = (L*T - 1)/2.0;
+  for(int q = 0; q < L*T; q++) {
+    t = q - centre;
+    h[q] = 2.0*cutoff*((t == 0.0) ? 1.0 : sin(2.0*M_PI*cutoff*t)/(2.0*M_PI*cutoff*t));
+    h[q] *= kaiser(t/centre, beta);
+    sum += h[q];
+  }
+
+  coeff.resize(L*T);
+  for(int p = 0; p < L; p++)
+    for(int j = 0; j < T; j++)
+      coeff[p*T + j] = h[p + (T - 1 - j)*L]*L/sum;	// unitary gain at DC for every phase
+
+  history.resize(T - 1 + BLOCK);
+  reset();
+}
+
+
+void Cresampler::reset()
+{
+  for(unsigned int i = 0; i < history.size(); i++) history[i] = 0.0;
+  fill = T - 1;
+  pos = T - 1;
+  phase = 0;
+}
+
+
+
+int Cresampler::needed(int outputs) const
+{
+  long long last;
+
+  if(outputs <= 0) return 0;
+
+  last = pos + (phase + (long long)(outputs - 1)*M)/L;	// newest input of the last output
+  return (last < fill) ? 0 : int(last - fill + 1);
+}
+
+
+int Cresampler::process(const float* in, int n, float* out)
+{
+  int produced = 0;
+  int chunk, shift;
+
+  while(n > 0) {
+    chunk = int(history.size()) - fill;
+    if(chunk > n) chunk = n;
+    memcpy(&history[fill], in, chunk*sizeof(float));
+    fill += chunk;
+    in += chunk;
+    n -= chunk;
+
+    while(pos < fill) {
+      out[produced++] = dot(&coeff[phase*T], &history[pos - T + 1]);
+      phase += M;
+      pos += phase/L;
+      phase %= L;
+    }
+
+    shift = pos - T + 1;		// the oldest sample still needed
+    if(shift > fill) shift = fill;
+    memmove(&history[0], &history[shift], (fill - shift)*sizeof(float));
+    fill -= shift;
+    pos -= shift;
+  }
+
+  return produced;
+}
+
+
+double Cresampler::lag() const
+{
+  const double last = double(pos)*L + phase - M;	// position of the last output at the rate fin*L
+
+  return (fill - 1) - (last - (L*T - 1)/2.0)/L;
+}
+
+
+
+float Cresampler::dot(const float* c, const float* x) const
+{
+  switch(simd_level()) {
+    case 2:	return dot_avx2(c, x, T);
+    case 1:	return dot_sse(c, x, T);
+    default:	return dot_scalar(c, x, T);
+  }
+}
+
+
+float Cresampler::dot_scalar(const float* c, const float* x, int n)
+{
+  float s = 0.0;
+
+  for(int i = 0; i < n; i++) s += c[i]*x[i];
+  return s;
+}
+
+
+#ifdef SRC_X86
+
+__attribute__((target("sse")))
+float Cresampler::dot_sse(const float* c, const float* x, int n)
+{
+  __m128 a = _mm_setzero_ps(), b = _mm_setzero_ps();
+  float s[4];
+
+  for(int i = 0; i < n; i += 8) {
+    a = _mm_add_ps(a, _mm_mul_ps(_mm_loadu_ps(c + i), _mm_loadu_ps(x + i)));
+    b = _mm_add_ps(b, _mm_mul_ps(_mm_loadu_ps(c + i + 4), _mm_loadu_ps(x + i + 4)));
+  }
+  _mm_storeu_ps(s, _mm_add_ps(a, b));
+
+  return (s[0] + s[1]) + (s[2] + s[3]);
+}
+
+
+__attribute__((target("avx2")))
+float Cresampler::dot_avx2(const float* c, const float* x, int n)
+{
+  __m256 a = _mm256_setzero_ps();
+  __m128 h;
+  float s[4];
+
+  for(int i = 0; i < n; i += 8)
+    a = _mm256_add_ps(a, _mm256_mul_ps(_mm256_loadu_ps(c + i), _mm256_loadu_ps(x + i)));
+  h = _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+  _mm_storeu_ps(s, h);
+
+  return (s[0] + s[1]) + (s[2] + s[3]);
+}
+
+#else
+
+float Cresampler::dot_sse(const float* c, const float* x, int n)
+{
+  return dot_scalar(c, x, n);
+}
+
+float Cresampler::dot_avx2(const float* c, const float* x, int n)
+{
+  return dot_scalar(c, x, n);
+}
+
+#endif
+
+
+
+// Kaiser window for x in [-1, 1]
+double Cresampler::kaiser(double x, double beta)
+{
+  if(fabs(x) > 1.0) return 0.0;
+
+  return bessel_i0(beta*sqrt(1.0 - x*x))/bessel_i0(beta);
+}
+
+
+// modified Bessel function of the first kind, order 0 (power series)
+double Cresampler::bessel_i0(double x)
+{
+  double s = 1.0, term = 1.0;
+
+  for(int k = 1; k < 50; k++) {
+    term *= (x/(2.0*k))*(x/(2.0*k));
+    s += term;
+    if(term < 1e-12*s) break;
+  }
+  return s;
+}
@@ -0,0 +1,100 @@
+/*
+    Class Cresampler - Part of the SRCclock program.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CRESAMPLER_H
+#define CRESAMPLER_H
+
+
+#include <vector>
+
+
+
+/**
+ * @brief Polyphase decimator with rational ratio L/M (e.g. 44100 Hz -> 8000 Hz is 80/441).
+ *
+ * The low pass prototype is a Kaiser windowed sinc (60 dB of attenuation) designed at the rate fin*L and split into L
+ * phases of T taps. Only the phase needed by each output sample is evaluated, so the cost is T multiply-adds per output
+ * whatever the ratio is. The band [0, 0.375*fout] is passed, the aliases fall over 0.625*fout. The coefficients of each phase
+ * are stored reversed so every output is a contiguous dot product, vectorized with SSE or AVX2 when available.
+ * All the memory is allocated by set(): process() never allocates.
+ *
+ * @class Cresampler
+ * @author Vittorio Tornielli di Crestvolant   <vittorio.tornielli@gmail.com>
+ * @version 1.0
+ * @date 2009-2014
+ */
+
+class Cresampler {
+    int fin, fout;		// input and output sampling frequencies
+    int L, M;			// interpolation and decimation factors
+    int T;			// taps of each phase (multiple of 8)
+    std::vector<float> coeff;	// T reversed coefficients for each of the L phases
+    std::vector<float> history;	// last T-1 input samples followed by the new ones
+    int fill;			// samples stored in history
+    int pos;			// index in history of the newest input of the next output
+    int phase;			// phase of the next output
+
+public:
+    Cresampler();
+    Cresampler(int input_frequency, int output_frequency);
+
+    void set(int input_frequency, int output_frequency);	/**< Design the filter for the new ratio and reset the state */
+    void reset();		/**< Forget the past input. The filter starts from zeros */
+
+    int input_frequency() const { return fin; }		/**< Return the input sampling frequency */
+    int output_frequency() const { return fout; }	/**< Return the output sampling frequency */
+    int taps() const { return T; }			/**< Return the taps of each phase */
+
+
+    /**
+     * @brief Return the number of input samples to be processed in order to get exactly the given number of output samples
+     *
+     * @param outputs Number of output samples wanted
+     */
+    int needed(int outputs) const;
+
+
+    /**
+     * @brief Filter and decimate the input samples
+     *
+     * @param in Input samples
+     * @param n Number of input samples
+     * @param out Output samples. Its size must be enough for the outputs (see needed())
+     * @return int number of output samples written
+     */
+    int process(const float* in, int n, float* out);
+
+
+    /**
+     * @brief Delay of the last output sample with respect to the last input sample processed, in input samples.
+     *
+     * It includes the group delay of the filter and the input samples processed after the one aligned with the last output.
+     */
+    double lag() const;
+
+private:
+    float dot(const float* c, const float* x) const;
+    static float dot_scalar(const float* c, const float* x, int n);
+    static float dot_sse(const float* c, const float* x, int n);
+    static float dot_avx2(const float* c, const float* x, int n);
+    static double kaiser(double x, double beta);
+    static double bessel_i0(double x);
+};
+
+#endif // CRESAMPLER_H
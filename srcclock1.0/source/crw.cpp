@@ -29,6 +29,7 @@ Crw::Crw()
 //  fd = -1;
   sound_stream = NULL;
   sound_error = 0;
+  fragsize = tlength = prebuf = -1;
   
 
 }
@@ -83,6 +84,7 @@ bool Crw::open_file_output(const char* fileNAme)
 bool Crw::open_soundStream_output(int fc, int channels, const char* device, pa_sample_format SampFormat, const char* appName)
 {
   pa_sample_spec ss;		// stream properties
+  pa_buffer_attr attr;
   
   ss.format = SampFormat;
   ss.channels = channels;
@@ -99,7 +101,7 @@ bool Crw::open_soundStream_output(int fc, int channels, const char* device, pa_s
                    "Clock",            // Description of our stream.
                    &ss,                // Our sample format.
                    NULL,               // Use default channel map
-                   NULL,               // Use default buffering attributes.
+                   buffer_attr(ss, attr),	// buffering attributes
                    &sound_error        // error code.
                    );
 
@@ -122,6 +124,7 @@ bool Crw::open_soundStream_output(int fc, int channels, const char* device, pa_s
 bool Crw::open_soundStream_input(int fc, int channels, const char* device, pa_sample_format SampFormat, const char* appName)
 {
   pa_sample_spec ss;		// stream properties
+  pa_buffer_attr attr;
   
   ss.format = SampFormat;
   ss.channels = channels;
@@ -138,7 +141,7 @@ bool Crw::open_soundStream_input(int fc, int channels, const char* device, pa_sa
                    "Clock",            // Description of our stream.
                    &ss,                // Our sample format.
                    NULL,               // Use default channel map
-                   NULL,               // Use default buffering attributes.
+                   buffer_attr(ss, attr),	// buffering attributes
                    &sound_error        // Ignore error code.
                    );
 
@@ -184,6 +187,39 @@ int Crw::readBuffer(void* buffer, int samples, int size)
   return samples_read;
 }
 
+void Crw::set_buffer_attr(long frag, long target, long pre)
+{
+  fragsize = frag;
+  tlength = target;
+  prebuf = pre;
+}
+
+
+const pa_buffer_attr* Crw::buffer_attr(const pa_sample_spec& ss, pa_buffer_attr& attr) const
+{
+  if((fragsize < 0) && (tlength < 0) && (prebuf < 0)) return NULL;
+
+  attr.maxlength = (uint32_t) -1;
+  attr.minreq = (uint32_t) -1;
+  attr.fragsize = (fragsize < 0) ? (uint32_t) -1 : pa_usec_to_bytes(fragsize, &ss);
+  attr.tlength = (tlength < 0) ? (uint32_t) -1 : pa_usec_to_bytes(tlength, &ss);
+  attr.prebuf = (prebuf < 0) ? (uint32_t) -1 : pa_usec_to_bytes(prebuf, &ss);
+
+  return &attr;
+}
+
+
+long Crw::get_input_latency()
+{
+  pa_usec_t latency;
+
+  if(INstate != 2) return 0;
+
+  latency = pa_simple_get_latency(sound_stream, &sound_error);
+  return (latency == (pa_usec_t) -1) ? 0 : long(latency);
+}
+
+
 int Crw::writeBuffer(const void* buffer, int samples, int size)
 {
   int samples_written = 0;
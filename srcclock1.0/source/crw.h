@@ -54,6 +54,9 @@ class Crw {
     pa_simple*	sound_stream;			// Descriptor of the PulseAudio stream
     
     int		sound_error;			// variable that identifies the last error in sound stream
+    long	fragsize, tlength, prebuf;	// buffer attributes of the sound streams in microseconds. Negative = chosen by the server
+
+    const pa_buffer_attr* buffer_attr(const pa_sample_spec& ss, pa_buffer_attr& attr) const;	// NULL for the default attributes
 
 public:
   /**
@@ -104,6 +107,20 @@ public:
     virtual bool open_soundStream_input(int fc, int channels, const char* device = 0, pa_sample_format SampFormat = PA_SAMPLE_U8, const char* appName = 0);
     
     
+    /**
+     * @brief Set the buffer attributes of the sound streams opened afterwards. The negative values are chosen by the server
+     *
+     * The simple API of PulseAudio connects the streams with PA_STREAM_ADJUST_LATENCY, so the server sizes the buffers
+     * of the device too: fragsize becomes the latency of a recording stream and tlength the one of a playback stream.
+     *
+     * @param frag Size of the fragments of a recording stream in microseconds
+     * @param target Target length of the buffer of a playback stream in microseconds
+     * @param pre Data buffered before starting a playback stream in microseconds
+     **/
+    void set_buffer_attr(long frag, long target = -1, long pre = -1);
+    void set_latency(long usec) { set_buffer_attr(usec, usec); }	/**< Ask the server a latency of usec microseconds for both the directions */
+    void set_buffer_attr(const Crw& other) { set_buffer_attr(other.fragsize, other.tlength, other.prebuf); }	/**< Use the buffer attributes of other */
+
     virtual bool open_file_output(const char* fileNAme);	/**< Open the output stream on file */
     virtual bool open_file_input(const char* fileNAme);		/**< Open the output stream on file */
     
@@ -113,6 +130,12 @@ public:
 
 
 
+    /**
+     * @brief Return the latency of the input stream in microseconds: the time spent by the samples in the buffers of
+     * the sound server (pa_simple_get_latency()) before being read. 0 for files or if unknown
+     **/
+    long get_input_latency();
+
     std::string get_sound_error() const { return pa_strerror(sound_error); }	/**< Return a string of the previous pulseaudio error */
     
     
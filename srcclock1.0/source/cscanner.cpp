@@ -0,0 +1,227 @@
+/*
+    Class Cscanner - Implementation.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <thread>
+#include <atomic>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "cscanner.h"
+#include "csrc.h"
+
+
+#define LEAD		5	// seconds decoded before the chunk, for the WDS
+#define OVERLAP		10	// seconds decoded after the chunk: the end of the frame and the RP
+#define MIN_CHUNK	60	// minimum length of a chunk in seconds
+#define BLOCK		8192	// samples fed to the decoder at once
+
+
+
+Cscanner::Cscanner(const Csrc& src)
+: settings(src)
+{
+  fd = -1;
+  data = NULL;
+  length = 0;
+  samples = 0;
+  sample_frequency = 8000;
+  channels = 1;
+  s16 = false;
+  iso = false;
+}
+
+Cscanner::~Cscanner()
+{
+  close();
+}
+
+
+bool Cscanner::open(const char* fileName, int fc, int ch, bool s16le)
+{
+  const size_t size = s16le ? sizeof(int16_t) : sizeof(float);
+  struct stat st;
+  void* p;
+
+  close();
+
+  fd = ::open(fileName, O_RDONLY);
+  if(fd < 0) return false;
+
+  if((fstat(fd, &st) != 0) || (st.st_size < off_t(size*ch))) {
+    close();
+    return false;
+  }
+
+  p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if(p == MAP_FAILED) {
+    close();
+    return false;
+  }
+  madvise(p, st.st_size, MADV_WILLNEED);	// the chunks are read at the same time by all the threads
+
+  data = p;
+  length = st.st_size;
+  s16 = s16le;
+  sample_frequency = fc;
+  channels = ch;
+  samples = length/(size*ch);
+
+  return true;
+}
+
+
+void Cscanner::close()
+{
+  if(data != NULL) munmap(const_cast<void*>(data), length);
+  if(fd >= 0) ::close(fd);
+
+  fd = -1;
+  data = NULL;
+  length = 0;
+  samples = 0;
+}
+
+
+
+int Cscanner::scan(int threads)
+{
+  const long long lead = (long long)(LEAD)*sample_frequency;
+  const long long overlap = (long long)(OVERLAP)*sample_frequency;
+  long long chunk;
+  int chunks;
+  std::vector<std::vector<Cminute> > results;
+  std::vector<std::thread> pool;
+  std::atomic<int> next(0);
+
+  found.clear();
+  if(data == NULL) return 0;
+
+  if(threads <= 0) threads = std::thread::hardware_concurrency();
+  if(threads <= 0) threads = 1;
+
+  chunk = (samples + 4*threads - 1)/(4*threads);		// a few chunks for each thread balance the load
+  if(chunk < (long long)(MIN_CHUNK)*sample_frequency) chunk = (long long)(MIN_CHUNK)*sample_frequency;
+  chunks = (samples + chunk - 1)/chunk;
+  if(threads > chunks) threads = chunks;
+  results.resize(chunks);
+
+  std::vector<Csrc> src(threads);	// one decoder for each thread
+
+  for(int t = 0; t < threads; t++) {
+    src[t] = settings;
+    src[t].sample_frequency = sample_frequency;
+    src[t].verbose_level = 0;		// the threads would mix their logs
+  }
+
+  for(int t = 0; t < threads; t++)
+    pool.push_back(std::thread([&, t]() {
+      int i;
+      long long a, b;
+
+      while((i = next++) < chunks) {
+        a = i*chunk;
+        b = (a + chunk < samples) ? a + chunk : samples;
+        decode(src[t], (a > lead) ? a - lead : 0, (b + overlap < samples) ? b + overlap : samples, a, b, results[i]);
+      }
+    }));
+
+  for(int t = 0; t < threads; t++) pool[t].join();
+
+  for(int i = 0; i < chunks; i++)
+    found.insert(found.end(), results[i].begin(), results[i].end());
+
+  return found.size();
+}
+
+
+
+/* Decoding of the samples [from, to). Only the minutes whose frame ends in [own_from, own_to) are kept.
+   The decoder is restarted after each minute.
+*/
+void Cscanner::decode(Csrc& src, long long from, long long to, long long own_from, long long own_to, std::vector<Cminute>& out) const
+{
+  const float* f = static_cast<const float*>(data);
+  const int16_t* q = static_cast<const int16_t*>(data);
+  std::vector<float> mono(((channels > 1) && !s16) ? BLOCK : 0);
+  std::vector<int16_t> mono16(((channels > 1) && s16) ? BLOCK : 0);
+  Cdecoder decoder(src, s16);	// 16 bit samples are decoded as they are
+  Cevent e;
+  Cminute m;
+  bool open = false;		// the minute is waiting for the RP
+  long long k;
+  int n;
+
+  for(k = from; k < to; k += n) {
+    n = (to - k < BLOCK) ? int(to - k) : BLOCK;
+
+    src.stats.block();
+    if(channels == 1) {
+      if(s16) decoder.feed(&q[k], n);
+      else decoder.feed(&f[k], n);
+    }
+    else if(s16) {
+      for(int i = 0; i < n; i++) {
+        int s = 0;
+        for(int j = 0; j < channels; j++) s += q[(k + i)*channels + j];
+        mono16[i] = int16_t(s/channels);
+      }
+      decoder.feed(&mono16[0], n);
+    }
+    else {
+      for(int i = 0; i < n; i++) {
+        float s = 0.0;
+        for(int j = 0; j < channels; j++) s += f[(k + i)*channels + j];
+        mono[i] = s/channels;
+      }
+      decoder.feed(&mono[0], n);
+    }
+
+    while(decoder.event(e)) {
+      switch(e.type) {
+        case EVENT_FRAME:	m.frame = from + e.sample;
+				m.sync = -1;
+				m.fraction = 0.0;
+				m.ticks.clear();
+				open = true;
+				break;
+        case EVENT_TICK:	if(open) m.ticks.push_back(from + e.sample);
+				break;
+        case EVENT_SYNC:	m.sync = from + e.sample;
+				m.fraction = e.fraction;
+				break;
+        default:		break;
+      }
+    }
+
+    if(decoder.done()) {
+      if(open && (m.frame >= own_from) && (m.frame < own_to)) {
+        m.date = src.dateSTR(iso);
+        out.push_back(m);
+      }
+      open = false;
+      decoder.start();
+    }
+  }
+
+  if(open && (m.frame >= own_from) && (m.frame < own_to)) {	// RP cut by the end of the file
+    m.date = src.dateSTR(iso);
+    out.push_back(m);
+  }
+}
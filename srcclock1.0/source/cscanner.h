@@ -0,0 +1,106 @@
+/*
+    Class Cscanner - Part of the SRCclock program.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CSCANNER_H
+#define CSCANNER_H
+
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+
+class Csrc;
+
+
+
+/**
+ * @brief Minute decoded by Cscanner. The sample indexes refer to the beginning of the file
+ */
+struct Cminute {
+  long long frame;		/**< First sample after the frame (second 53.480 of the minute) */
+  long long sync;		/**< First sample after the last RP (second 0 of the next minute). -1 if not syncronised */
+  double fraction;		/**< Sub-sample offset of the alignment of the RP */
+  std::vector<long long> ticks;	/**< First sample of each RP received */
+  std::string date;		/**< Date and time decoded: second 0 of the next minute if syncronised, else the end of the frame */
+};
+
+
+
+/**
+ * @brief Decode every minute of a raw recording (float samples) in parallel.
+ *
+ * The file is mapped in memory and split in chunks that are decoded by a pool of threads, each chunk with its own
+ * Cdecoder restarted after each minute. The chunks overlap, so the minutes across the borders are decoded as a
+ * whole: a minute belongs to the chunk where its frame ends. Each chunk starts a few seconds earlier than its
+ * border, the time needed by the WDS to adapt the threshold. The minutes found are merged in order of time.
+ *
+ * @class Cscanner
+ * @author Vittorio Tornielli di Crestvolant   <vittorio.tornielli@gmail.com>
+ * @version 1.0
+ * @date 2009-2014
+ */
+
+class Cscanner {
+    const Csrc& settings;	// decoding settings (thresholds, WDS, frame detection, sync)
+    int fd;
+    const void* data;		// the mapped file
+    size_t length;		// bytes mapped
+    bool s16;			// 16 bit samples instead of float
+    long long samples;		// samples of each channel
+    int sample_frequency;
+    int channels;
+    bool iso;			// date in the format ISO 8601
+    std::vector<Cminute> found;
+
+public:
+    Cscanner(const Csrc& src);	/**< Scanner using the decoding settings of src */
+    ~Cscanner();
+
+
+    /**
+     * @brief Map the raw file in memory
+     *
+     * @param fileName Name of the file (float samples, interleaved if stereo)
+     * @param fc Sampling frequency
+     * @param ch Channels: 1 = mono; 2 = stereo (the channels are averaged)
+     * @param s16le The samples are 16 bit little endian integers instead of float. The file is mapped as it is, at half the memory
+     * @return bool true if the file has been mapped
+     */
+    bool open(const char* fileName, int fc, int ch, bool s16le = false);
+    void close();		/**< Unmap the file */
+
+
+    /**
+     * @brief Decode all the minutes of the file
+     *
+     * @param threads Number of threads. 0 = one for each core
+     * @return int number of minutes decoded
+     */
+    int scan(int threads = 0);
+
+    void set_iso(bool iso8601) { iso = iso8601; }		/**< Dates in the format ISO 8601 instead of RFC 2822 */
+    const std::vector<Cminute>& minutes() const { return found; }	/**< Return the minutes decoded by scan(), in order of time */
+    long long length_samples() const { return samples; }	/**< Return the number of samples of the file */
+
+private:
+    void decode(Csrc& src, long long from, long long to, long long own_from, long long own_to, std::vector<Cminute>& out) const;
+};
+
+#endif // CSCANNER_H
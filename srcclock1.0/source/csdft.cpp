@@ -0,0 +1,93 @@
+/*
+    Class Csdft - Implementation.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cmath>
+#include "csdft.h"
+
+
+using std::complex;
+using std::polar;
+
+
+
+Csdft::Csdft()
+{
+  N = 0;
+}
+
+Csdft::Csdft(int fc, const std::vector<int>& frequencies, int window)
+{
+  set(fc, frequencies, window);
+}
+
+Csdft::Csdft(int fc, int frequency, int window)
+{
+  set(fc, std::vector<int>(1, frequency), window);
+}
+
+
+void Csdft::set(int fc, const std::vector<int>& frequencies, int window)
+{
+  double w;
+
+  N = window;
+  freq = frequencies;
+  rot.resize(freq.size());
+  wrap.resize(freq.size());
+
+  for(unsigned int i = 0; i < freq.size(); i++) {
+    w = 2.0 * M_PI * freq[i] / fc;
+    rot[i] = polar(1.0, w);
+    wrap[i] = polar(1.0, -w*N);
+  }
+}
+
+
+template<typename T> void Csdft::sliding(int tone, const T* data, double scale, int windows, double* p) const
+{
+  const complex<double> r = rot[tone];
+  const complex<double> z = wrap[tone];
+  const double w = std::arg(r);
+  const double norm = 4.0*scale*scale/(double(N)*N);
+  complex<double> acc(0.0, 0.0);
+
+  if(windows < 1) return;
+
+  for(int m = 0; m < N; m++)			// first window: direct DFT
+    acc += double(data[m])*polar(1.0, -w*m);
+  p[0] = std::norm(acc)*norm;
+
+  for(int k = 1; k < windows; k++) {		// next windows: sliding recursion
+    acc = r*(acc - double(data[k-1]) + double(data[k-1+N])*z);
+    p[k] = std::norm(acc)*norm;
+  }
+}
+
+
+void Csdft::trace(int tone, const float* data, int windows, double* p) const
+{
+  sliding(tone, data, 1.0, windows, p);
+}
+
+
+// the recursion runs on the integers as they are, the power is scaled at the end
+void Csdft::trace(int tone, const int16_t* data, int windows, double* p) const
+{
+  sliding(tone, data, 1.0/32768, windows, p);
+}
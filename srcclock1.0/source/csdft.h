@@ -0,0 +1,88 @@
+/*
+    Class Csdft - Part of the SRCclock program.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CSDFT_H
+#define CSDFT_H
+
+
+#include <vector>
+#include <complex>
+#include <cstdint>
+
+
+
+/**
+ * @brief Sliding DFT tone tracker. The power of each tone is traced over consecutive windows of N samples.
+ *
+ * The DFT bin of a tone over a window of N samples is updated with the recursion
+ * \f$X_n = e^{j\omega}(X_{n-1} - x_{n-N} + x_n e^{-j\omega N})\f$, therefore each window after the first one costs a
+ * few operations instead of a complete Goertzel. The frequency of the tones does not need to be an integer bin of the
+ * window. The returned power is normalized like the one of Cgoertzel.
+ *
+ * @class Csdft
+ * @author Vittorio Tornielli di Crestvolant   <vittorio.tornielli@gmail.com>
+ * @version 1.0
+ * @date 2009-2014
+ */
+
+class Csdft {
+    int N;					// samples of the window
+    std::vector<int> freq;			// frequencies of the tones
+    std::vector<std::complex<double> > rot;	// e^{jw}
+    std::vector<std::complex<double> > wrap;	// e^{-jwN}
+
+public:
+    Csdft();
+
+    /**
+     * @brief Tracker of the tones over a window of N samples
+     *
+     * @param fc Sampling frequency
+     * @param frequencies Frequencies of the tones in Hz
+     * @param window Number of samples of the window
+     */
+    Csdft(int fc, const std::vector<int>& frequencies, int window);
+    Csdft(int fc, int frequency, int window);		/**< Tracker of a single tone */
+
+    void set(int fc, const std::vector<int>& frequencies, int window);	/**< Set sampling frequency, tones and window */
+
+    int tones() const { return freq.size(); }		/**< Return the number of tones */
+    int frequency(int tone) const { return freq[tone]; }	/**< Return the frequency of a tone in Hz */
+    int window() const { return N; }			/**< Return the number of samples of the window */
+
+
+    /**
+     * @brief Power trace of a tone over a block of samples. p[k] is the power of the window that starts at data[k]
+     *
+     * The first window is calculated directly, the following ones with the sliding recursion. The block must contain
+     * at least windows + window() - 1 samples.
+     *
+     * @param tone Index of the tone
+     * @param data Pointer to the first sample of the block
+     * @param windows Number of windows (and of elements of p)
+     * @param p Output array
+     */
+    void trace(int tone, const float* data, int windows, double* p) const;
+    void trace(int tone, const int16_t* data, int windows, double* p) const;	/**< Power trace over 16 bit samples (full scale 32768) */
+
+private:
+    template<typename T> void sliding(int tone, const T* data, double scale, int windows, double* p) const;
+};
+
+#endif // CSDFT_H
@@ -0,0 +1,102 @@
+/*
+    Class Cservo - Implementation.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cmath>
+#include "cservo.h"
+
+
+#define MAX_FREQUENCY	500e-6	// limit of the frequency correction of the kernel
+#define MAX_SLEW	500e-6	// slew rate of adjtime()
+#define JITTER_WEIGHT	0.25	// weight of a new offset in the jitter
+
+
+
+Cservo::Cservo(double step_threshold, double p, double i)
+{
+  kp = p;
+  ki = i;
+  max_frequency = MAX_FREQUENCY;
+  max_slew = MAX_SLEW;
+  set_step_threshold(step_threshold);
+
+  reset();
+}
+
+
+void Cservo::reset(double frequency)
+{
+  samples = 0;
+  last_offset = last_time = 0.0;
+  drift = clamp(frequency);
+  phase = step = 0.0;
+  jitter2 = 0.0;
+}
+
+
+
+int Cservo::update(double offset, double time)
+{
+  const double dt = time - last_time;
+  const bool beyond = (threshold > 0.0) && (fabs(offset) > threshold);
+  int action;
+
+  phase = step = 0.0;
+
+  if((samples > 0) && (dt <= 0.0)) return SERVO_NONE;	// no time elapsed: the frequency cannot be measured
+
+  if(samples >= 2) {
+    const double d = offset - last_offset;
+    jitter2 += (d*d - jitter2)*JITTER_WEIGHT;
+  }
+
+  switch(samples) {
+    case 0:	action = beyond ? SERVO_STEP : SERVO_NONE;
+		break;
+
+    case 1:	drift = clamp(drift + (offset - last_offset)/dt);	// FLL: frequency error between the first two offsets
+		action = beyond ? SERVO_STEP : SERVO_SLEW;
+		if(!beyond) phase = slewable(kp*offset, dt);
+		break;
+
+    default:	if(beyond) action = SERVO_STEP;
+		else {
+		  phase = slewable(kp*offset, dt);
+		  if(phase == kp*offset) drift = clamp(drift + ki*offset/dt);	// while the slew is limited, the offset is not a frequency error
+		  action = SERVO_SLEW;
+		}
+  }
+
+  if(action == SERVO_STEP) {
+    step = offset;
+    offset = 0.0;		// the next offset starts from a clock on time
+  }
+  else offset -= phase;		// the part slewed is not there anymore at the next offset, the rest is
+
+  last_offset = offset;
+  last_time = time;
+  samples++;
+
+  return action;
+}
+
+
+double Cservo::get_jitter() const
+{
+  return sqrt(jitter2);
+}
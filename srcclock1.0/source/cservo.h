@@ -0,0 +1,104 @@
+/*
+    Class Cservo - Part of the SRCclock program.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CSERVO_H
+#define CSERVO_H
+
+
+
+/**
+ * @brief Corrections asked by Cservo::update()
+ */
+enum Cservo_action {
+  SERVO_NONE,		/**< No correction: the first offset has been stored */
+  SERVO_STEP,		/**< Step the clock by the offset (see Cservo::get_step()) */
+  SERVO_SLEW		/**< Slew the clock by get_phase() and set its frequency correction to get_frequency() */
+};
+
+
+
+/**
+ * @brief Servo disciplining a clock to the offsets measured from the SRC.
+ *
+ * The second offset, compared with the first one, gives the frequency error of the clock (FLL). From then on the servo
+ * is a PI controller on the phase: a fraction kp of each offset is slewed by the clock and a fraction ki, divided by
+ * the time elapsed since the previous offset, is added to the frequency correction. The gains are per update, so they
+ * fit any interval (one minute for the SRC). Offsets beyond the step threshold step the clock instead, keeping the
+ * frequency. The clock slews at a limited rate (500 us/s for adjtime()) and a new slew replaces the one still running,
+ * so the phase slewed is limited to what the clock can do in the time elapsed since the previous offset: the rest is
+ * still there at the next offset and is slewed then. The jitter is the RMS of the difference of successive offsets, averaged exponentially as in NTP.
+ *
+ * The offset is the reference time minus the time of the clock, so a positive offset means a clock late and a
+ * positive frequency correction a clock made faster. Times in seconds, frequencies in s/s (1e-6 = 1 ppm).
+ *
+ * @class Cservo
+ * @author Vittorio Tornielli di Crestvolant   <vittorio.tornielli@gmail.com>
+ * @version 1.0
+ * @date 2009-2014
+ */
+
+class Cservo {
+    double kp, ki;		// gains for each update
+    double threshold;		// offsets beyond it are stepped. 0 = never step
+    double max_frequency;
+    double max_slew;		// slew rate of the clock (s/s)
+    int samples;		// offsets received since the reset
+    double last_offset, last_time;
+    double drift;		// frequency correction
+    double phase;		// offset to slew
+    double step;		// offset to step
+    double jitter2;		// mean square of the difference of successive offsets
+
+public:
+    Cservo(double step_threshold = 0.128, double p = 0.5, double i = 0.1);
+
+
+    /**
+     * @brief Restart the servo
+     *
+     * @param frequency Frequency correction already applied to the clock (e.g. the one of the kernel)
+     */
+    void reset(double frequency = 0.0);
+
+
+    /**
+     * @brief Give a new offset to the servo
+     *
+     * @param offset Reference time minus time of the clock
+     * @param time Reference time of the measure
+     * @return int The correction to be applied to the clock (Cservo_action)
+     */
+    int update(double offset, double time);
+
+    void set_step_threshold(double s) { threshold = (s > 0.0) ? s : 0.0; }	/**< Offsets beyond s seconds are stepped. 0 = never step */
+    void set_max_frequency(double f) { max_frequency = f; }		/**< Limit of the frequency correction (default 500 ppm, as the kernel) */
+    void set_max_slew(double r) { max_slew = r; }			/**< Slew rate of the clock in s/s (default 500 ppm, as adjtime()) */
+
+    double get_step() const { return step; }		/**< Return the offset to be stepped */
+    double get_phase() const { return phase; }		/**< Return the offset to be slewed */
+    double get_frequency() const { return drift; }	/**< Return the frequency correction */
+    double get_jitter() const;				/**< Return the jitter of the offsets */
+    bool locked() const { return samples >= 2; }	/**< Return true when the frequency error has been estimated */
+
+private:
+    double clamp(double f) const { return (f > max_frequency) ? max_frequency : ((f < -max_frequency) ? -max_frequency : f); }
+    double slewable(double p, double dt) const { return (p > max_slew*dt) ? max_slew*dt : ((p < -max_slew*dt) ? -max_slew*dt : p); }
+};
+
+#endif // CSERVO_H
@@ -0,0 +1,46 @@
+/*
+    SIMD support - Part of the SRCclock program.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CSIMD_H
+#define CSIMD_H
+
+
+// The vector kernels are compiled with the target attribute, so the program runs on any CPU of the family
+// and the instruction set is chosen at runtime.
+#if defined(__x86_64__) || defined(__i386__)
+#define SRC_X86
+#include <immintrin.h>
+#endif
+
+
+
+/**
+ * @brief Return the vector instruction set available at runtime: 0 = scalar; 1 = SSE2; 2 = AVX2
+ */
+inline int simd_level()
+{
+#ifdef SRC_X86
+  static const int level = __builtin_cpu_supports("avx2") ? 2 : (__builtin_cpu_supports("sse2") ? 1 : 0);
+  return level;
+#else
+  return 0;
+#endif
+}
+
+#endif // CSIMD_H
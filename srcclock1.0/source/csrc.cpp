@@ -17,15 +17,23 @@
 */
 
 
+#include <algorithm>
 #include "csrc.h"
 
+
+#define MAX_CORRECTIONS		4	// bits corrected in a frame
+#define MAX_MARGIN		6.0	// dB. The bits decided with a larger margin are certain
+#define READ_BIN		0.25	// ms. Resolution of the distribution of the intervals between the readings
+#define READ_BINS		2000
+
+
 Csrc::Csrc()
-: Crw(), F0(2000), F1(2500), Fsync(1000), Ts(0.030), src_vector(48, -1), lout(), lerr(true)
+: Crw(), F0(2000), F1(2500), Fsync(1000), Ts(0.030), src_vector(48, -1), soft(48, 0.0), lout(), lerr(true), reads(READ_BIN, READ_BINS)
 {
-  /* initialize random seed: */
-  srand ( time(NULL) );
-  
   sample_frequency = 8000;	// default value for sample frequency
+  stream_frequency = 8000;
+  decimation = false;
+  resampler_lag = 0.0;
   soundChannels = 1;
   
   verbose_level = 1;		// level of debug messages
@@ -42,9 +50,23 @@ Csrc::Csrc()
   streamON = false;
   window_length = 50;
   snr_level = 16.0;
+  noise_estimator = NOISE_MEAN;
+  noise_percentile = 0.5;
+  frame_score = 0.0;
+  late_samples = 0;
+  metrics = NULL;
+  stream_format = PA_SAMPLE_FLOAT32LE;
+  corrections = 0;
+  corrected = 0;
+  confidence = 0.0;
+  tracking = track_clock = false;
+  confirmed = false;
 
   sys_clock = std::chrono::high_resolution_clock::now();
+  block = 0;
+  latency = 0;
   msec = 0;
+  fraction = 0.0;
   set_today();
 }
 
@@ -88,6 +110,14 @@ Csrc& Csrc::operator=(const Csrc& other)
 {
   if(this != &other) {
     src_vector = other.src_vector;
+    soft = other.soft;
+    corrections = other.corrections;
+    corrected = other.corrected;
+    confidence = other.confidence;
+    tracking = other.tracking;
+    track_clock = other.track_clock;
+    predicted = other.predicted;
+    confirmed = other.confirmed;
     decoded = other.decoded;
     year = other.year;
     month = other.month;
@@ -101,6 +131,10 @@ Csrc& Csrc::operator=(const Csrc& other)
     dst = other.dst;
     timeout = other.timeout;
     sample_frequency = other.sample_frequency;
+    stream_frequency = other.stream_frequency;
+    decimation = other.decimation;
+    resampler = other.resampler;
+    resampler_lag = other.resampler_lag;
     verbose_level = other.verbose_level;
     decision_threshold = other.decision_threshold;
     adaptive_decision_threshold = other.adaptive_decision_threshold;
@@ -108,10 +142,19 @@ Csrc& Csrc::operator=(const Csrc& other)
 
     error = other.error;
     msec = other.msec;
+    fraction = other.fraction;
     sys_clock = other.sys_clock;
+    block = other.block;
+    latency = other.latency;
     window_length = other.window_length;
     snr_level = other.snr_level;
+    noise_estimator = other.noise_estimator;
+    noise_percentile = other.noise_percentile;
+    frame_score = other.frame_score;
+    late_samples = other.late_samples;
     soundChannels = other.soundChannels;
+    stream_format = other.stream_format;
+    set_buffer_attr(other);
   }
 
   return *this;
@@ -122,8 +165,9 @@ bool Csrc::open_soundStream_input(int fc, int channels, const char* device, pa_s
 {
   streamON = Crw::open_soundStream_input(fc, channels, device, SampFormat, appName);
   if(streamON) {
-    sample_frequency = fc;
+    set_stream_frequency(fc);
     soundChannels = channels;
+    stream_format = SampFormat;
   }
   
   return streamON;
@@ -133,8 +177,9 @@ bool Csrc::open_soundStream_output(int fc, int channels, const char* device, pa_
 {
   streamON = Crw::open_soundStream_output(fc, channels, device, SampFormat, appName);
   if(streamON) {
-    sample_frequency = fc;
+    sample_frequency = stream_frequency = fc;
     soundChannels = channels;
+    stream_format = SampFormat;
   }
   
   return streamON;
@@ -143,8 +188,9 @@ bool Csrc::open_soundStream_output(int fc, int channels, const char* device, pa_
 
 bool Csrc::open_file_input(const char* fileNAme)
 {
-  sample_frequency = 8000;
+  sample_frequency = stream_frequency = 8000;
   soundChannels = 1;
+  stream_format = PA_SAMPLE_FLOAT32LE;
   streamON = Crw::open_file_input(fileNAme);
   
   return streamON;
@@ -153,47 +199,56 @@ bool Csrc::open_file_input(const char* fileNAme)
 
 bool Csrc::open_file_output(const char* fileNAme)
 {
-  sample_frequency = 8000;
+  sample_frequency = stream_frequency = 8000;
   soundChannels = 1;
+  stream_format = PA_SAMPLE_FLOAT32LE;
   streamON = Crw::open_file_output(fileNAme);
   
   return streamON;
 }
 
-bool Csrc::open_file_input(const char* fileNAme, int fc, int channels)
+bool Csrc::open_file_input(const char* fileNAme, int fc, int channels, pa_sample_format SampFormat)
 { 
   streamON = Crw::open_file_input(fileNAme);
   if(streamON) {
-    sample_frequency = fc;
+    set_stream_frequency(fc);
     soundChannels = channels;
+    stream_format = SampFormat;
   }
   return streamON;
 }
 
-bool Csrc::open_file_output(const char* fileNAme, int fc, int channels)
+bool Csrc::open_file_output(const char* fileNAme, int fc, int channels, pa_sample_format SampFormat)
 {
   streamON = Crw::open_file_output(fileNAme);
   if(streamON) {
-    sample_frequency = fc;
+    sample_frequency = stream_frequency = fc;
     soundChannels = channels;
+    stream_format = SampFormat;
   }
   return streamON;
 }
 
 int Csrc::readBuffer(float* buffer, int samples)
 {
+  const int requested = samples;
   int r = 0;
 
   if(!running) return 0;
+  stats.block();		// the reading starts a block of the stream
 
-  if(samples >= 0) {
+  if(stream_frequency != sample_frequency) {	// the decimated samples are mono
+    r = read_decimated(buffer, samples);
+    samples = 0;
+  }
+  else if(samples >= 0) {
     reset_buffer(buffer, samples*soundChannels);	// clear the buffer only for the number of samples to read
-    r = Crw::readBuffer(buffer, samples*soundChannels, sizeof(float));
-    sys_clock = std::chrono::high_resolution_clock::now();		// start counting the system ticks
+    r = read_stream(buffer, samples*soundChannels);
+    stamp(r/soundChannels);
   }
 
 
-  if((soundChannels == 2) && (r > 0)) {
+  if((soundChannels == 2) && (r > 0) && (samples > 0)) {
     int i;
     r /= 2;			// r is the number of samples (non stereo)
     for(i = 0; i < r; i++) {
@@ -203,20 +258,193 @@ int Csrc::readBuffer(float* buffer, int samples)
     for(i = r; i < 2*r; i++)	// put the unused samples to zero to prevent errors
       buffer[i] = 0.0;
   }
-  
+
+  stats.read(requested, r);
+  stats.lap(STAGE_READ);
+
   return r;		// returns the number of samples read
 }
 
+
+int Csrc::readFrames(float* buffer, int frames)
+{
+  int r = 0;
+
+  if(!running) return 0;
+
+  if(frames > 0) {
+    reset_buffer(buffer, frames*soundChannels);
+    r = read_stream(buffer, frames*soundChannels);
+    stamp(r/soundChannels);
+  }
+
+  return (r > 0) ? r/soundChannels : r;
+}
+
+
+/* The stream is read in pieces of at most one second, the size of the capture buffer allocated when the stream is opened.
+   The resampler asks exactly the input samples needed for the outputs wanted, so no sample is left behind. As read_stream(),
+   returns -1 at the end of the stream (or on error) if no sample has been produced */
+int Csrc::read_decimated(float* buffer, int samples)
+{
+  const int size = capture.size()/soundChannels;
+  int produced = 0;
+  int n, r;
+
+  reset_buffer(buffer, samples);
+
+  while(produced < samples) {
+    n = resampler.needed(samples - produced);
+    if(n > size) n = size;
+
+    r = read_stream(&capture[0], n*soundChannels);
+    stamp(r/soundChannels);
+    if(r <= 0) return (produced > 0) ? produced : r;
+
+    r /= soundChannels;
+    if(soundChannels == 2)
+      for(int i = 0; i < r; i++) capture[i] = (capture[i*2] + capture[i*2 + 1])/2.0;
+
+    produced += resampler.process(&capture[0], r, buffer + produced);
+    resampler_lag = resampler.lag()/stream_frequency;
+    if(r < n) break;			// end of the stream
+  }
+
+  return produced;
+}
+
+
+/* The samples still buffered by the sound server were captured after the last one read, so the first sample of the
+   block was captured latency plus the duration of the block before the reading. A negative number of samples (end of
+   the stream or error) counts as an empty block */
+void Csrc::stamp(int samples)
+{
+  const std::chrono::high_resolution_clock::time_point now = std::chrono::high_resolution_clock::now();
+
+  block = (samples > 0) ? samples : 0;
+  latency = get_input_latency();
+  sys_clock = now - std::chrono::microseconds(latency + block*1000000ll/stream_frequency);
+
+  if(last_read != std::chrono::high_resolution_clock::time_point())
+    reads.add(std::chrono::duration<double, std::milli>(now - last_read).count());
+  last_read = now;
+}
+
+
+void Csrc::reset_reads()
+{
+  reads.reset();
+  last_read = std::chrono::high_resolution_clock::time_point();
+}
+
+
+void Csrc::log_reads()
+{
+  if((get_INstate() != 2) || (reads.count() == 0) || (verbose_level < 2)) return;
+
+  lout <<"Read intervals (" <<int(reads.count()) <<" readings): mean " <<reads.mean() <<" ms; std. dev. " <<reads.stddev()
+       <<" ms; min " <<reads.min() <<" ms; median " <<reads.percentile(0.5) <<" ms; 99% " <<reads.percentile(0.99)
+       <<" ms; max " <<reads.max() <<" ms. Latency: " <<latency <<" us\n";
+}
+
+
+void Csrc::log_stats(bool always)
+{
+  if(!always && (verbose_level < 2)) return;
+
+  stats.summary(lout);
+}
+
+
+void Csrc::set_stream_frequency(int fc)
+{
+  stream_frequency = fc;
+  sample_frequency = fc;
+  resampler_lag = 0.0;
+
+  if(decimation && (fc > 8000)) {
+    sample_frequency = 8000;
+    resampler.set(fc, sample_frequency);
+    capture.resize(fc*2);		// one second of stereo samples
+    if(verbose_level >= 2) lout <<"Decimation " <<fc <<" Hz -> " <<sample_frequency <<" Hz; " <<resampler.taps() <<" taps per phase\n";
+  }
+}
+
+
 int Csrc::writeBuffer(const float* buffer, int samples)
 {
   int s = 0;
 
-  if(running) s = Crw::writeBuffer(buffer, samples*soundChannels, sizeof(float));
+  if(running) s = write_stream(buffer, samples*soundChannels);
 
   return s;
 }
 
 
+int Csrc::readBuffer(int16_t* buffer, int samples)
+{
+  const int requested = samples;
+  int r = 0;
+
+  if(!running) return 0;
+  if(!s16_input()) return -1;
+  stats.block();		// the reading starts a block of the stream
+
+  if(samples > 0) {
+    if(int(raw.size()) < samples*soundChannels) raw.resize(samples*soundChannels);
+    r = Crw::readBuffer(&raw[0], samples*soundChannels, sizeof(int16_t));
+    stamp(r/soundChannels);
+  }
+
+  if(r > 0) {
+    r /= soundChannels;
+    if(soundChannels == 1) std::copy(raw.begin(), raw.begin() + r, buffer);
+    else
+      for(int i = 0; i < r; i++) {
+        int s = 0;
+        for(int j = 0; j < soundChannels; j++) s += raw[i*soundChannels + j];
+        buffer[i] = s/soundChannels;
+      }
+  }
+  for(int i = (r > 0) ? r : 0; i < samples; i++)	// put the unused samples to zero to prevent errors
+    buffer[i] = 0;
+
+  stats.read(requested, r);
+  stats.lap(STAGE_READ);
+
+  return r;
+}
+
+
+// The 16 bit samples are converted from and to float at the border of the stream (full scale 32768)
+int Csrc::read_stream(float* buffer, int samples)
+{
+  int r;
+
+  if(stream_format != PA_SAMPLE_S16LE) return Crw::readBuffer(buffer, samples, sizeof(float));
+
+  if(int(raw.size()) < samples) raw.resize(samples);
+  r = Crw::readBuffer(&raw[0], samples, sizeof(int16_t));
+  for(int i = 0; i < r; i++) buffer[i] = raw[i]*(1.0f/32768);
+
+  return r;
+}
+
+
+int Csrc::write_stream(const float* buffer, int samples)
+{
+  if(stream_format != PA_SAMPLE_S16LE) return Crw::writeBuffer(buffer, samples, sizeof(float));
+
+  if(int(raw.size()) < samples) raw.resize(samples);
+  for(int i = 0; i < samples; i++) {
+    float s = buffer[i]*32768;
+    raw[i] = (s >= 32767) ? 32767 : ((s <= -32768) ? -32768 : int16_t(lrintf(s)));
+  }
+
+  return Crw::writeBuffer(&raw[0], samples, sizeof(int16_t));
+}
+
+
 
 int Csrc::parity(int beg, int end) const
 {
@@ -287,45 +515,6 @@ tm Csrc::get_date_tm() const
 
 
 
-double Csrc::randn(double mu, double sigma)
-{
-  static bool deviateAvailable=false; // flag
-  static float storedDeviate;         // deviate from previous calculation
-  double polar, rsquared, var1, var2;
-
-  if(sigma == 0.0) {
-    deviateAvailable = false;
-    return mu;
-  }
-
-  if (!deviateAvailable) {
-    do {
-      var1=2.0*( double(rand())/double(RAND_MAX) ) - 1.0;
-      var2=2.0*( double(rand())/double(RAND_MAX) ) - 1.0;
-      rsquared=var1*var1+var2*var2;
-  } while ( rsquared>=1.0 || rsquared == 0.0);
-
-  // calculate polar tranformation for each deviate
-  polar=sqrt(-2.0*log(rsquared)/rsquared);
-
-  // store first deviate and set flag
-  storedDeviate=var1*polar;
-  deviateAvailable=true;
-
-  // return second deviate
-  return var2*polar*sigma + mu;
-  }
-  
-  // If a deviate is available from a previous call to this function, it is
-  // returned, and the flag is set to false.
-  else {
-    deviateAvailable=false;
-    return storedDeviate*sigma + mu;
-  }
-}
-
-
-
 bool Csrc::P1() const
 {
   return src_vector[16] == parity(0, 15);
@@ -360,6 +549,8 @@ void Csrc::reset()
   decoded = false;
   decision_threshold = pow(10, (-35.0/10.0));		// power decision threshold
   sample_frequency = 8000;
+  stream_frequency = 8000;
+  resampler_lag = 0.0;
   verbose_level = 1;
   running = false;
   error = -1;
@@ -368,9 +559,21 @@ void Csrc::reset()
   do_sync = true;
   timeout = 600;
   sys_clock = std::chrono::high_resolution_clock::now();
+  block = 0;
+  latency = 0;
   msec = 0;
+  fraction = 0.0;
   window_length = 50;
   snr_level = 16.0;
+  noise_estimator = NOISE_MEAN;
+  noise_percentile = 0.5;
+  frame_score = 0.0;
+  late_samples = 0;
+  corrections = 0;
+  corrected = 0;
+  confidence = 0.0;
+  tracking = track_clock = false;
+  confirmed = false;
 }
 
 void Csrc::stop()
@@ -432,10 +635,8 @@ void Csrc::play(double power, bool initial_delay, bool random_theta, double nois
 
   const int N = sample_frequency*Ts;	// number of samples per tone (bit)
   float theta = 0.0;
-  float* tone_buffer = new float[sample_frequency*soundChannels];
   float amplitude;		// amplitude of the sinusoidal wave
-  int samples, k;
-  int freq;
+  int c = 0;			// initial delay
   
   encode();
   
@@ -452,148 +653,70 @@ void Csrc::play(double power, bool initial_delay, bool random_theta, double nois
   running = true;
   
   if(random_theta) {	// set a random theta!
-    int v = rand() % 360;
+    int v = random.below(360);
     theta = v/180.0*M_PI;
     if(verbose_level >= 1) lout <<"Random Theta: " <<v <<"° (" <<theta <<" rad)\n";
   }
 
   // delay before starting trasmission
   if(initial_delay) {
-    int c;
-    c = rand() % sample_frequency;  // delay < 1 second
+    c = random.below(sample_frequency);  // delay < 1 second
     if(verbose_level >= 1) lout <<"Initial delay: " <<c <<" samples. (" <<float(c/float(sample_frequency)) 
 				<<" secs)\n";
-    
-    for(int i = 0; i < c; i++) {
-      tone_buffer[i*soundChannels] = randn(0, noise_sigma);
-      checkSample(tone_buffer[i*soundChannels]);
-      stereo_encode(tone_buffer, i*soundChannels);
-      if(verbose_level >= 5)
-	lout <<"Random value: " <<tone_buffer[i*soundChannels] <<'\n';
-    }
-    Csrc::writeBuffer(tone_buffer, c);
   }
   
   if(power > 0) power *= -1;
   amplitude = pow(10, (power/20.0));
+
+  stats.mark();
+  synth.set(sample_frequency, amplitude, theta);
+  synth.clear();
+  synth.silence(c);
    
   for(int i = 0; i < 48; i++) {
-    if(i == 32) {
-      samples = 0.04*sample_frequency;
-      for(k = 0; k < samples; k++) {
-	tone_buffer[k*soundChannels] = randn(0, noise_sigma);
-	checkSample(tone_buffer[k*soundChannels]);
-	stereo_encode(tone_buffer, k*soundChannels);
-      }
-      Csrc::writeBuffer(tone_buffer, samples);
-    }
-
-
-    if(src_vector[i] == 0) freq = F0;		// chooses the right frequency
-    else freq = F1;
-      
-    for(k = 0; k < N; k++) {
-      tone_buffer[k*soundChannels] = amplitude*cos(2.0*M_PI*freq/sample_frequency*k + theta) + randn(0, noise_sigma);
-      checkSample(tone_buffer[k*soundChannels]);
-      stereo_encode(tone_buffer, k*soundChannels);
-    }
-    Csrc::writeBuffer(tone_buffer, N);
+    if(i == 32) synth.silence(int(0.04*sample_frequency));
 
+    synth.tone((src_vector[i] == 0) ? F0 : F1, N);	// chooses the right frequency
   }	// end of bit transmission
   
 
 // plays the SYNC beeps
 
   if(do_sync) {
-    int ticks = number_of_RP();
+    const int ticks = number_of_RP();
+    const int samples = 0.1*sample_frequency;
 
-    samples = 0.52*sample_frequency;
-    for(k = 0; k < samples; k++) {
-      tone_buffer[k*soundChannels] = randn(0, noise_sigma);
-      checkSample(tone_buffer[k*soundChannels]);
-      stereo_encode(tone_buffer, k*soundChannels);
-    }
-    Csrc::writeBuffer(tone_buffer, samples);
-    
+    synth.silence(int(0.52*sample_frequency));
 
-    
-    for(int i = 0; i < 5; i++) {				// plays 5 ticks (syncronization)
-      samples = 0.1*sample_frequency;
-      for(k = 0; k < samples; k++) {
-        tone_buffer[k*soundChannels] = amplitude*cos(2.0*M_PI*Fsync/sample_frequency*k + theta) + randn(0, noise_sigma);
-        checkSample(tone_buffer[k*soundChannels]);
-        stereo_encode(tone_buffer, k*soundChannels);
-      }
-    
-    
-      while (k < sample_frequency) {
-        tone_buffer[k*soundChannels] = randn(0, noise_sigma);
-        checkSample(tone_buffer[k*soundChannels]);
-        stereo_encode(tone_buffer, k*soundChannels);
-        k++;
-      }
-      Csrc::writeBuffer(tone_buffer, sample_frequency);
+    for(int i = 0; i < 5; i++) {			// plays 5 ticks (syncronization)
+      synth.tone(Fsync, samples);
+      synth.silence(sample_frequency - samples);
     }
 
-
     if(ticks >= 6) {
-    
-      for(k = 0; k < sample_frequency; k++) {		// 1 second of silence before the last tick
-        tone_buffer[k*soundChannels] = randn(0, noise_sigma);
-        checkSample(tone_buffer[k*soundChannels]);
-        stereo_encode(tone_buffer, k*soundChannels);
-      }
-    
-      Csrc::writeBuffer(tone_buffer, sample_frequency);
-    
-      samples = 0.1*sample_frequency;
-      for(k = 0; k < samples; k++) {			// this is the last tick!
-        tone_buffer[k*soundChannels] = amplitude*cos(2.0*M_PI*Fsync/sample_frequency*k + theta) + randn(0, noise_sigma);
-        checkSample(tone_buffer[k*soundChannels]);
-        stereo_encode(tone_buffer, k*soundChannels);
-      }
-    
-      Csrc::writeBuffer(tone_buffer, samples);
+      synth.silence(sample_frequency);			// 1 second of silence before the last tick
+      synth.tone(Fsync, samples);			// this is the last tick!
 
       if(ticks == 7) {
-        samples = 0.9*sample_frequency;
-        for(k = 0; k < samples; k++) {
-          tone_buffer[k*soundChannels] = randn(0, noise_sigma);
-          checkSample(tone_buffer[k*soundChannels]);
-          stereo_encode(tone_buffer, k*soundChannels);
-        }
-
-        Csrc::writeBuffer(tone_buffer, samples);
-
-        samples = 0.1*sample_frequency;
-        for(k = 0; k < samples; k++) {
-          tone_buffer[k*soundChannels] = amplitude*cos(2.0*M_PI*Fsync/sample_frequency*k + theta) + randn(0, noise_sigma);
-          checkSample(tone_buffer[k*soundChannels]);
-          stereo_encode(tone_buffer, k*soundChannels);
-        }
-        Csrc::writeBuffer(tone_buffer, samples);
+        synth.silence(int(0.9*sample_frequency));
+        synth.tone(Fsync, samples);
       }
     }
-    add_minute();
   }
 
-  error = 0;
-  running = false;
-  delete[] tone_buffer;
-}
-
-inline void Csrc::stereo_encode(float* p, int k)
-{
-  if(soundChannels == 2)
-    p[k + 1] = p[k];
-}
+  if(noise_sigma != 0.0) random.add(synth.data(), synth.size(), noise_sigma);
 
+  const float* frames = synth.interleave(soundChannels);
+  if(verbose_level >= 5)
+    for(int i = 0; i < c; i++) lout <<"Random value: " <<frames[i*soundChannels] <<'\n';
+  stats.lap(STAGE_RENDER);
+  Csrc::writeBuffer(frames, synth.size());
+  stats.lap(STAGE_WRITE);
 
+  if(do_sync) add_minute();
 
-inline void Csrc::checkSample(float& s)
-{
-  if(s < -1) s = -1;
-  else if (s > 1) s = 1;
+  error = 0;
+  running = false;
 }
 
 
@@ -645,10 +768,6 @@ void Csrc::encode()
 
 
 
-
-
-
-
 int Csrc::setWDS(int Wlength, double snr)
 {
   if(Wlength < 1) {
@@ -668,10 +787,35 @@ int Csrc::setWDS(int Wlength, double snr)
 }
 
 
+void Csrc::set_corrections(int bits)
+{
+  corrections = std::min(std::max(bits, 0), MAX_CORRECTIONS);
+
+  if((corrections > 0) && (verbose_level >= 2)) lout <<"Frame correction: up to " <<corrections <<" bits\n";
+}
+
+
+void Csrc::set_tracking(bool on, bool clock)
+{
+  tracking = on;
+  track_clock = on && clock;
+  predicted.clear();
 
+  if(tracking && (verbose_level >= 2)) lout <<"Frame tracking" <<(track_clock ? " from the system clock\n" : "\n");
+}
 
 
+void Csrc::set_noise_estimator(int estimator, double percentile)
+{
+  noise_estimator = ((estimator >= NOISE_MEAN) && (estimator <= NOISE_PERCENTILE)) ? estimator : NOISE_MEAN;
+  noise_percentile = ((percentile > 0.0) && (percentile < 1.0)) ? percentile : 0.5;
 
+  if(verbose_level >= 2) {
+    lout <<"WDS. Noise estimator: ";
+    if(noise_estimator == NOISE_PERCENTILE) lout <<"percentile " <<100*noise_percentile <<"%\n";
+    else lout <<((noise_estimator == NOISE_EWMA) ? "EWMA\n" : "mean\n");
+  }
+}
 
 
 
@@ -681,8 +825,10 @@ int Csrc::setWDS(int Wlength, double snr)
 
 
 
-
-
+/* The stream is read and fed to the decoder (see Cdecoder), that is the state machine of the acquisition and of the
+   syncronisation. The reads stop at the end of each window needed by the decoder, so when the RP have been received
+   the last sample read is the end of the last RP and microsecDelay() measures the time elapsed since then.
+*/
 bool Csrc::decode()
 {
   if(!streamON) {
@@ -690,304 +836,281 @@ bool Csrc::decode()
     error = -2;
     return false;
   }
-  else reset_src_vector();
 
-  const int N = int(sample_frequency*Ts);
-  const int DELTA = N;
-  const int STEP = N/30;			// tuning function with 1 microsec uncertainty
-  long int total = 0;
-  float* buffer = new float[(2*N + DELTA)*soundChannels];
-  double power0, power1;
-  int r, c, bytes2read, extra;
-  vector<double> window(window_length, 0.0);	// vector of avarage of level of noise in the last symbols
-  double avg;
+  const int size = 2*int(0.1*sample_frequency) + int(sample_frequency*Ts);	// longest read requested by the decoder
+  const bool s16 = s16_input();		// the 16 bit samples are decoded as they are
+  vector<float> buffer(s16 ? 0 : size*soundChannels);
+  vector<int16_t> buffer16(s16 ? size : 0);
+  Cdecoder decoder(*this, s16);
+  Cevent e;
+  int n, r;
 
+  late_samples = 0;
+  reset_reads();
 
-  decoded = false;
-  
   if(verbose_level >= 2) lout <<"Threshold: " <<get_decision_threshold() <<" dB\n";
-  
-  reset_buffer(buffer, (2*N + DELTA)*soundChannels);
-  c = 0;		// number of bits decoded
-  bytes2read = N;
-  extra = 0;
-  error = -1;
-  
-  power0 = power1 = 0.0;
+  if(verbose_level >= 3) lout <<"Goertzel engine: " <<Cgoertzel::simd_name() <<'\n';
 
 // The cycle that acquires the SRC data starts here
   running = true;
 
-  while(running && ((total*N/sample_frequency) < timeout) && (!decoded)) {	// iterates till: running is true, the timeout is not expired and the SRC has not been decoded
-    r = read_buffer(buffer, 2*N, bytes2read, extra);
+  while(running && !decoder.done()) {	// iterates till: running is true and the decoder has not finished (decoded or timeout)
+    n = decoder.wanted();
+    if(n > size) n = size;
 
+    r = s16 ? readBuffer(&buffer16[0], n) : readBuffer(&buffer[0], n);
     if(r < 0) {	// error in the input stream
       running = false;
-      decoded = false;
       error = -3;
       if(verbose_level >= 1) lerr <<"EE: Reading error!!\n";
       break;
     }
 
-    power0 = goertzel(F0, &buffer[N], N);	// power associated to frequency F0
-    power1 = goertzel(F1, &buffer[N], N);	// power associated to frequency F1
-
-
-    //---------------------------------------------------------------- Window Calibration System
-    if(window_length > 0) {	// WDS is on
-      window[total % window_length] = (power0 + power1)/2.0;
-      if(((total / window_length) != 0) && (c == 0)) {
-        avg = 0.0;
-        for(int i = 0; i < window_length; i++) avg += window[i];
-        avg /= window_length;	// average noise level in the last symbols time
-        decision_threshold = avg*snr_level;
-        if(decision_threshold > 1)
-          decision_threshold = max(avg, 1.0/snr_level);
-        if(verbose_level >= 4)
-          lout <<"Threshold now is " <<get_decision_threshold() <<" dB. Noise average of the last " <<window_length
-               <<" time symbols is " <<10*log10(avg) <<" dB; Pass: " <<total <<'\n';
-      }
-    }	//------------------------------------------------------------ End of Window Calibration System
+    if(s16) decoder.feed(&buffer16[0], n);	// at the end of the stream the missing samples are zeros
+    else decoder.feed(&buffer[0], n);
 
+    while(decoder.event(e))
+      if((e.type == EVENT_FRAME) || (e.type == EVENT_SYNC))
+        late_samples = decoder.position() - e.sample;		// samples read after the reference of the timing
+  }
 
+  if(!running) decoded = false;
 
-    if(verbose_level >= 5) {
-      lout <<"[DEBUG] Pass " <<total <<" Power : " <<10*log10(power0) <<" dB; Power2 : " <<10*log10(power1) <<" dB\n";
-    }
+  running = false;	// finished! stop running!
+  log_reads();
+  
+  return decoded;
+}			// end of decode() function!
 
 
-	//  || ((c > 0) && (c != 32))
-    if((power0 > decision_threshold) || (power1 > decision_threshold)) {	// checks wheter one of the two frequencies has reached the threshold
-      if(((c == 0) || (c == 32)) && (verbose_level >= 2)) {
-	lout <<"Supposed detection at pass " <<total <<". Power level: " <<10*log10(max(power0, power1)) <<" dB for frequency ";
-	if(power0 > power1) lout <<"F0\n";
-	else lout <<"F1\n";
-        lout <<"Decision Threshold: " <<get_decision_threshold() <<" dB\n";
-      }
-      
-      if(power0 > power1) {  // 0
-	if(c == 0) {  // syncronization of first block
-	  bytes2read = tuning(F0, buffer, extra, N, DELTA, STEP, power0);
-	  if(verbose_level >= 2) lout <<"Tuned @ pass: " <<total <<'\n';
-          avg = 0.0;	// reset avg in order to calculate the average of the power of the tones F0 and F1
-	}
-	src_vector[c] = 0;
-      }
-      else {  // 1
-	if(c == 32) {  // syncronization of second block
-	  bytes2read = tuning(F1, buffer, extra, N, DELTA, STEP, power1);
-	  if(verbose_level >= 2) lout <<"Tuned @ pass: " <<total <<'\n';
-	}
-	src_vector[c] = 1;
-      }
-      if(verbose_level >= 3) lout <<'[' <<itos(c,2) <<"] " <<src_vector[c] <<" Power: " <<10*log10(max(power0, power1)) <<" dB\n";
-      c++;
-      avg += max(power0, power1);
+bool Csrc::frame_decode()
+{
+  decoded = false;
+  check(48);		// checks the entire binary sequence
+  if(error == 0) {
+    int lp;
+    hour = deconvert(2, 6);
+    min = deconvert(8, 7);
+    dst = bool(src_vector[15]);
+
+    month = deconvert(17, 5);
+    day = deconvert(22, 6);
+    wday = deconvert(28, 3);
+    year = deconvert(34, 8) + 2000;
+
+    change_time = deconvert(42, 3);
+    lp = deconvert(45, 2);
+    switch(lp) {
+      case 0: leap_second = 0;
+	      break;
+      case 2: leap_second = +1;
+	      break;
+      case 3: leap_second = -1;
+	      break;
+      default: error = 5;
     }
-    else if(c != 0)
-           src_vector[c++] = -1;		// if the symbol is under threshold during the transmission forces a reset.
-    
-    
-    if(!check(c)) {
-      if(verbose_level >= 2) lout <<"EE: Detection error. RESET\nPass " <<total <<"; Error code: " <<error <<"\n-----\n";
+    sec = 53;
+    msec = 480;
 
-      c = 0;
-      avg = 0.0;
-      reset_buffer(buffer, (2*N + DELTA)*soundChannels);
-      reset_src_vector();
-    }
-    
-    
+    decoded = ID1() && P1() && P2() && ID2() && PA() && (error == 0) && valid_date();	// decoded!!
+  }
 
-    if(c == 32) {
-    /* At this point the first block has been decoded.
-       Time to clear the noise samples between the first and second block
-       and to reset the buffer in order to avoid wrong calculation of the power of the next tone.
-    */
-      r = readBuffer(buffer, 0.04*sample_frequency);
-      reset_buffer(buffer, (2*N + DELTA)*soundChannels);
-    }
+  return decoded;
+}
 
-    total++;	// another sample has been processed!
 
 
-// ***
-// Check whether all the 48 symbols have been received
-// ***
-    if(c == 48) {
-      check(48);		// checks the entire binary sequence
-      if(error == 0) {
-        int lp;
-        hour = deconvert(2, 6);
-        min = deconvert(8, 7);
-        dst = bool(src_vector[15]);
-      
-        month = deconvert(17, 5);
-        day = deconvert(22, 6);
-        wday = deconvert(28, 3);
-        year = deconvert(34, 8) + 2000;
-      
-        change_time = deconvert(42, 3);
-        lp = deconvert(45, 2);
-        switch(lp) {
-	  case 0: leap_second = 0;
-		  break;
-	  case 2: leap_second = +1;
-		  break;
-	  case 3: leap_second = -1;
-		  break;
-	  default: error = 5;
-        }
-        sec = 53;
-        msec = 480;
+/* Only the frames with at most corrections uncertain bits (decided within MAX_MARGIN) are corrected: the others are
+   likely misaligned or buried in the noise. All the combinations of the uncertain bits are tried and the valid frame
+   flipping the least total confidence is kept. The confidence of the frame is the margin of its weakest bit, negative
+   if that bit has been corrected */
+bool Csrc::frame_correct()
+{
+  const double dB = 10/log(10.0);
+  vector<int> weak;		// uncertain bits
+  vector<int> hard;
+  double best = -1.0, cost;
+  int mask, chosen = 0;
 
-	decoded = (c == 48) && ID1() && P1() && P2() && ID2() && PA() && (error == 0) && valid_date();	// decoded!!
-      }
-      
-      if(!decoded) {
-        if(verbose_level >= 2) lout <<"EE: decoding error after 48 symbols. Error code: " <<error <<"; Valid date: "
-					<<valid_date() <<"\nResetting...\n";
-        c = 0;
-        avg = 0.0;
-        reset_src_vector();
+  corrected = 0;
+
+  if(!frame_decode() && (corrections > 0)) {
+    hard = src_vector;
+    for(int i = 0; i < 48; i++) {
+      if((hard[i] != 0) && (hard[i] != 1)) hard[i] = (soft[i] > 0.0) ? 1 : 0;
+      if(dB*fabs(soft[i]) < MAX_MARGIN) weak.push_back(i);
+    }
+
+    if(int(weak.size()) <= corrections) {
+      for(mask = 1; mask < (1 << weak.size()); mask++) {
+        cost = 0.0;
+        for(unsigned int i = 0; i < weak.size(); i++) if(mask & (1 << i)) cost += fabs(soft[weak[i]]);
+        if((best >= 0.0) && (cost >= best)) continue;
+
+        src_vector = hard;
+        for(unsigned int i = 0; i < weak.size(); i++) if(mask & (1 << i)) src_vector[weak[i]] ^= 1;
+        if(frame_decode()) {
+          best = cost;
+          chosen = mask;
+        }
       }
     }
+    else if(verbose_level >= 2) lout <<"Frame not corrected: " <<int(weak.size()) <<" uncertain bits\n";
+
+    src_vector = hard;
+    for(unsigned int i = 0; i < weak.size(); i++)
+      if(chosen & (1 << i)) {
+        src_vector[weak[i]] ^= 1;
+        corrected++;
+      }
+    if(!frame_decode()) corrected = 0;
   }
-//--------------------------------------------------------------------------------
-// end of the SRC data
 
-  delete[] buffer;
+  confidence = 0.0;
+  if(decoded) {
+    frame_confidence(48);
+    if((corrected > 0) && (verbose_level >= 1)) lout <<"Frame corrected: " <<corrected <<" bits; confidence: " <<confidence <<" dB\n";
+  }
 
-  if(!running) {
-    decoded = false;
-    return decoded;
+  return decoded;
+}
+
+
+void Csrc::frame_confidence(int bits)
+{
+  const double dB = 10/log(10.0);
+
+  for(int i = 0; i < bits; i++) {
+    double margin = dB*fabs(soft[i]);
+    if((src_vector[i] == 1) != (soft[i] > 0.0)) margin = -margin;	// corrected bit
+    if((i == 0) || (margin < confidence)) confidence = margin;
   }
-  else if(c < 48) {
-    if(verbose_level >= 1) lerr <<"*** TIMEOUT! ***\n";
-    set_today();
-    error = 6;
-    decoded = false;
-    return decoded;
+}
+
+
+
+/* encode() writes src_vector, so the date and the frame are saved and restored around it. The frame of a minute is
+   transmitted from its second 52, so the prediction from the clock moves to the next minute after the second 53 */
+void Csrc::predict(bool clock)
+{
+  const vector<int> frame = src_vector;
+  const int MI = min, OR = hour, GM = day, GS = wday, ME = month, AN = year, SE = change_time, SI = leap_second, S = sec;
+  const bool OE = dst;
+
+  if(clock) {
+    time_t t = time(NULL);
+    tm now;
+
+    localtime_r(&t, &now);
+    if(now.tm_sec >= 53) {
+      t += 60;
+      localtime_r(&t, &now);
+    }
+    min = now.tm_min;
+    hour = now.tm_hour;
+    day = now.tm_mday;
+    wday = (now.tm_wday == 0) ? 7 : now.tm_wday;
+    month = now.tm_mon + 1;
+    year = now.tm_year + 1900;
+    dst = (now.tm_isdst > 0);
+    change_time = 7;		// the second block is not predicted from the clock
+    leap_second = 0;
   }
+  else add_minute();
 
-  
-//--------------------------------------------------------------------------------
-// Syncronization
-//--------------------------------------------------------------------------------
-  if((do_sync == true) && (error == 0) && running && decoded) {
-    const int Nsync = int(0.1*sample_frequency);			// samples for syncronization signal
-    const int DELTAsync = Nsync;
-    const int STEPsync = Nsync/100;
-    float* syncBuffer = new float[(2*Nsync + DELTAsync)*soundChannels];
-    double power = 0.0;
-    int ticks;
-    int noise_symbols;
-    long int syncTimeout, syncTimeout_sec;
-    
-    if(verbose_level >= 1) lout <<"---- SRC received! Synchronization! ----\n";
-    
-    reset_buffer(syncBuffer, (2*Nsync + DELTAsync)*soundChannels);
-    
-    c = 0;			// ticks decoded
-    bytes2read = Nsync;
-    extra = 0;
-    syncTimeout = 0;
-    noise_symbols = 5;		// 5 noise symbols to process before the sequence of RP
-    ticks = number_of_RP();	// determines the number of RP to expect
-
-    error = 7;			// SRC decoded but not syncronised
-    msec = 0;
-    syncTimeout_sec = ticks + 1;	// the total duration of the sync timeout in seconds is the number of ticks plus
-					// 1 second between the last two RP. In this calculation also the time elapsed between
-					// the end of segment S2 and the first RP is considered.
-
-    if(ticks != 6) {
-      if(verbose_level >= 1) lout <<"This minute has " <<(60+leap_second) <<" seconds! The sync ticks are " <<ticks <<'\n';
-      leap_second = 0;
+  encode();
+  predicted = src_vector;
+  if(verbose_level >= 2) lout <<"Predicted frame: " <<itos(hour, 2) <<':' <<itos(min, 2) <<' ' <<itos(day, 2) <<'/' <<itos(month, 2) <<'/' <<year <<'\n';
+
+  src_vector = frame;
+  min = MI;
+  hour = OR;
+  day = GM;
+  wday = GS;
+  month = ME;
+  year = AN;
+  change_time = SE;
+  leap_second = SI;
+  sec = S;
+  dst = OE;
+}
+
+
+/* The bits of the first block must be equal to the predicted ones, but for up to corrections uncertain bits (decided
+   within MAX_MARGIN), which are corrected */
+bool Csrc::match_prediction()
+{
+  const double dB = 10/log(10.0);
+  int wrong = 0;
+
+  confirmed = false;
+  if(predicted.empty()) return false;
+
+  for(int i = 0; i < 32; i++)
+    if(src_vector[i] != predicted[i]) {
+      if(dB*fabs(soft[i]) >= MAX_MARGIN) return false;
+      wrong++;
     }
+  if(wrong > corrections) return false;
 
-    if(adaptive_decision_threshold)
-      decision_threshold = max(decision_threshold, avg/(snr_level*48));	// updated the decision TH from the previous F0 and F1 average power
+  for(int i = 0; i < 32; i++) src_vector[i] = predicted[i];
+  confirmed = true;
+  if(verbose_level >= 1) lout <<"Frame confirmed by the prediction (" <<wrong <<" bits corrected)\n";
 
-    while((c < ticks) && (((syncTimeout*Nsync)/sample_frequency) < syncTimeout_sec) && running) {
+  return true;
+}
 
-      r = read_buffer(syncBuffer, 2*Nsync, bytes2read, extra);
-      power = goertzel(Fsync, &syncBuffer[Nsync], Nsync);
 
-      if(noise_symbols > 0) {
-        decision_threshold = max(decision_threshold, power*snr_level);
-        if(decision_threshold > 1)
-          decision_threshold = max(power, 1.0/snr_level);
-        noise_symbols--;
-      }
+/* The second block received replaces the predicted one only if the frame is valid and the bits that differ are certain
+   (e.g. a warning of change of time not predicted), otherwise a block of noise might pass the checks */
+bool Csrc::frame_predicted()
+{
+  const double dB = 10/log(10.0);
+  bool certain = true;
 
-      if(power > decision_threshold) {
-        if(c == 0) {
-          if(verbose_level >= 3) lout <<"Supposed syncronisation RP at pass " <<syncTimeout <<". TH: " <<get_decision_threshold() <<" dB\n";
-	  bytes2read = tuning(Fsync, syncBuffer, extra, Nsync, DELTAsync, STEPsync, power);
+  if(!confirmed) return false;
 
-	  if(adaptive_decision_threshold) {
-	    decision_threshold = power/2.0;	// Sync threshold is -3 dB below the signal power
-	    if(verbose_level >= 2) lout <<"Synchronization threshold: " <<get_decision_threshold() <<" dB\n";
-	  }
-	}
+  for(int i = 32; i < 48; i++)
+    if((src_vector[i] != predicted[i]) && (dB*fabs(soft[i]) < MAX_MARGIN)) certain = false;
 
-        c++;
-	if(verbose_level >= 1) {
-	  if(c < ticks) {
-            lout <<"===== ";
-          }
-	  else lout <<"|||||";
-	  lout.flush();       // flush output buffer
-	  if(verbose_level >= 3) lout <<"Sync tick number: " <<c <<" Power: " <<10*log10(power) <<" dB; (TH: "
-					<<get_decision_threshold() <<" dB)\n";
-	}
-	sec++;
-      }
-      else if(verbose_level >= 4) lout <<"Sync under threshold: " <<10*log10(power) <<" dB\n";
-      syncTimeout++;
-    }
-    
-    if(c == ticks) {
-      long long nanosec;
-      add_minute();
-      error = 0;
-      if(verbose_level >= 1) lout <<" =====> [Synchronized!]\n";
-      msec = 100;
-      std::chrono::duration<double,std::ratio<1,1000000000>> time_span = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::high_resolution_clock::now() - sys_clock);
-      nanosec = time_span.count();	// syncronisation offset in nanoseconds since the reading of last RP
-
-      if(verbose_level >= 2) lout <<"Syncronisation offset in ns: " <<nanosec <<" ns\n";
-    }
-    else {
-      sec = 53;			// if the system is not able to syncronize, it chooses the end of the encoded block
-      if(verbose_level >= 1) lerr <<"\nEE: Sync timeout expired. Timeout: " <<((syncTimeout*Nsync)/sample_frequency) << " seconds.\n"
-				  <<"\tTicks received: " <<c <<" out of " <<ticks <<'\n';
-      error = 7;
+  corrected = 0;
+  confidence = 0.0;
+  if(certain && frame_decode()) frame_confidence(48);
+  else {
+    for(int i = 32; i < 48; i++) src_vector[i] = predicted[i];
+    if(frame_decode()) {
+      frame_confidence(32);
+      if(verbose_level >= 1) lout <<"Second block taken from the prediction\n";
     }
-    
-    delete[] syncBuffer;
   }
-//--------------------------------------------------------------------------------
-// END Syncronization
-//--------------------------------------------------------------------------------
-  running = false;	// finished! stop running!
-  
+
   return decoded;
-}			// end of decode() function!
+}
+
 
 
 long Csrc::microsecDelay() const
 {
   long int micro = 0;
 
-      std::chrono::duration<long int,std::ratio<1,1000000l>> time_span = std::chrono::duration_cast<std::chrono::duration<long int>>(std::chrono::high_resolution_clock::now() - sys_clock);
+  std::chrono::microseconds time_span = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - last_sample());
   micro = time_span.count();
+  micro += lround((late_samples - fraction)*1e6/sample_frequency);	// the tone ended fraction samples after the reference sample, late_samples before the last one read
+  micro += lround(resampler_lag*1e6);				// the decimated samples are late with respect to the stream
 
   return micro;
 }
 
 
+// high_resolution_clock is the system clock (CLOCK_REALTIME), so its epoch is the one of time()
+double Csrc::reference_time() const
+{
+  const double last = std::chrono::duration<double>(last_sample().time_since_epoch()).count();
+
+  return last - (late_samples - fraction)/sample_frequency - resampler_lag;
+}
+
+
 /** The leapsecond is applied at the enld of the month UTC time. This means that it applies at time 00:59 +0100
   *  or 01:59 +0200 of the 1st of the new month for the Italian time.
   * 
@@ -1010,6 +1133,15 @@ void Csrc::set_timeout(int seconds)
 }
 
 
+void Csrc::set_frame_detection(double score)
+{
+  if(score > 1.0) score = 1.0;
+  frame_score = (score > 0.0) ? score : 0.0;
+
+  if(verbose_level >= 2) lout <<"Frame detection: " <<(frame_score > 0.0 ? "ON" : "OFF") <<"; minimum score: " <<frame_score <<'\n';
+}
+
+
 double Csrc::set_decision_threshold(double dB)
 {
   if(dB > 0.0) dB *= -1;	// change the sign if not correct
@@ -1018,11 +1150,6 @@ double Csrc::set_decision_threshold(double dB)
   return decision_threshold;
 }
 
-inline double Csrc::get_decision_threshold() const
-{
-  return 10*log10(decision_threshold);
-}
-
 
 
 bool Csrc::valid_date() const
@@ -1071,7 +1198,6 @@ bool Csrc::valid_date() const
 
 
 
-
 bool Csrc::leapyear(int y)
 {
   return (!(y % 400) || (!(y % 4) && (y % 100)));
@@ -1091,107 +1217,6 @@ int Csrc::deconvert(int offset, int length)
 }
 
 
-inline void Csrc::reset_src_vector()
-{
-  for(int i = 0; i < 48; i++) src_vector[i] = -1;	// put all elements with an error value
-}
-
-inline void Csrc::reset_buffer(float* b, int size, float value)
-{
-  for(int i = 0; i < size; i++) b[i] = value;
-}
-
-
-int Csrc::read_buffer(float* b, int total_size, int& bytes2read, int& extra)
-{
-  int r;
-  int m = total_size/2;
-  float* pp;
-
-
-  if(bytes2read == m) {
-    for(int i = 0; i < (m+extra); i++) b[i] = b[m + i];
-    pp = &b[m + extra];
-    bytes2read -= extra;
-    extra = 0;
-  }
-  else pp = &b[2*m - bytes2read];
-  r = Csrc::readBuffer(pp, bytes2read);
-  if(r != bytes2read) bytes2read = m - r; //lerr <<"Read " <<r <<" samples instead " <<bytes2read <<"!\n";
-  else bytes2read = m;		// next time, m samples will be read
-
-  return r;
-}
-
-
-// implementation of the goertzel algorithm
-double Csrc::goertzel(int frequency, const float* data, int samples) const
-{
-  double coeff;
-  double V0, V1, V2;
-  double power;
-
-  // Initialize Goertzel Algorithm
-  V0 = V1 = V2 = 0.0;
-  coeff = 2.0*cos(2.0 * M_PI * frequency / sample_frequency);
-
-  for (int i = 0; i < samples; i++) {
-      V0 = data[i] + (coeff * V1) - V2;
-      V2 = V1;
-      V1 = V0;
-  }
-  power = V2*V2 + V1*V1 - coeff*V2*V1;		// not normalized power
-  power = power/(samples*samples)*4;		// normalization: it returns the power of the single side sinusoid
-
-  return power;
-}
-
-
-
-// Tuning function
-int Csrc::tuning(int freq, float* buffer, int& extra, int N, int DELTA, int STEP, double& p)
-{
-  int tuned, bytes2read;//, size;
-  double power, maxpower;
-
-  maxpower = 0.0;
-  const int start = N - DELTA;
-  const int end = N + DELTA;
-
-
-  Csrc::readBuffer(&buffer[2*N + extra], DELTA - extra);	// read DELTA more samples
-
-  for(int i = start; i <= end; i += STEP) {
-    power = goertzel(freq, &buffer[i], N);
-    if(verbose_level >= 6) lout <<"Power of frequency " <<freq <<" Hz, starting from sample " <<i <<" = " <<10*log10(power) <<" dB\n";
-    if(maxpower < power) {
-      tuned = i;
-      maxpower = power;
-      if(verbose_level >= 6) lout <<"Tuned!\tMax found in " <<i <<" = " <<10*log10(power) <<" dB\n";
-    }
-  }
-
-  // prepare the buffer for next reading
-  for(int i = 0; i < (2*N - tuned + DELTA); i++) buffer[i] = buffer[tuned + i];
-
-  if(tuned <= N) {
-    extra = DELTA - tuned;		// extra are the samples that exceed the next symbol.
-    bytes2read = 0;
-  }
-  else {
-    bytes2read = tuned - DELTA;		// in the buffer there are already N + DELTA - tuned samples
-    extra = 0;
-  }
-
-  if(verbose_level >= 3) lout <<"Tuning function. Tuned: " <<tuned <<" (start = " <<start <<"; end = " <<end <<"; step = " <<STEP <<")\n"
-			 <<"bytes2read : " <<bytes2read <<";  extra = " <<extra <<"; MaxPower: " <<10*log10(maxpower)
-			<<" dB\n";
-
-  p = maxpower;
-
-  return bytes2read;	// are the samples to read from the stream for the next symbol
-}
-
 
 string Csrc::itos(int value, int length, int base, char fill, bool force_sign)
 {
@@ -1307,14 +1332,6 @@ void Csrc::add_minute()
 }
 
 
-inline double Csrc::max(double a, double b) const
-{
-  if(a > b) return a;
-  else return b;
-}
-
-
-
 
 std::ostream& operator<<(std::ostream& os, const Csrc& src)
 {
@@ -1427,6 +1444,12 @@ void Csrc::logOnSTDOUT()
   lerr.streamOnSTDOUT();
 }
 
+void Csrc::logAsync(bool on)
+{
+  lout.setAsync(on);
+  lerr.setAsync(on);
+}
+
 void Csrc::errorLogOnFile(const char* fileName)
 {
   lerr.streamOnFile(fileName);
@@ -1535,7 +1558,6 @@ int* Csrc::get_src_vector_int() const
 
 
 
-
 void Csrc::close_all()
 {
   streamON = false;
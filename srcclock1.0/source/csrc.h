@@ -24,13 +24,26 @@
 #include <cmath>
 #include <ctime>
 #include <vector>
+#include <deque>
 #include <string>
 #include <cstdlib>
 #include <chrono>
 #include "crw.h"
 #include "clog.h"
+#include "cgoertzel.h"
+#include "csdft.h"
+#include "cdetector.h"
+#include "cnoise.h"
+#include "chistogram.h"
+#include "cstats.h"
+#include "cresampler.h"
+#include "csynth.h"
+#include "crandom.h"
+#include "cdecoder.h"
 
 
+class Cmetrics;
+
 
 using std::vector;
 using std::string;
@@ -49,6 +62,12 @@ using std::string;
 
 class Csrc : public Crw {
 
+  friend class Cdecoder;	// the decoder works on the settings and on the date of the object
+  friend class Cscanner;	// the scanner sets the sampling frequency of its decoders
+  friend class Cchannels;	// the channels are decoded on copies of the object, timed by its stream
+  friend class Cengine;		// the engine drives the streams of its copies of the object
+  friend class Ccorpus;		// the corpus is encoded from the date of the object and written on its stream
+
   const int F0;		// frequency of tone 0
   const int F1;		// frequency of tone 1
   const int Fsync;
@@ -59,17 +78,39 @@ class Csrc : public Crw {
   bool dst;
   
   int msec;		// milliseconds. Used to compensate the error on the syncronisation due to post processing of the samples
+  double fraction;	// sub-sample offset (in samples) of the last alignment found by the decoder. Range [-1/2, 1/2]
   
   vector<int> src_vector;
+  vector<double> soft;		// soft value of each symbol: log(power F1/power F0)
+  int corrections;		// maximum number of bits corrected in a frame. 0 = no correction
+  int corrected;		// bits corrected in the last frame
+  double confidence;		// margin in dB of the weakest bit of the last frame, negative if corrected
+  bool tracking;		// the next frame is predicted from the last one
+  bool track_clock;		// without a prediction, the frame is predicted from the system clock
+  vector<int> predicted;	// frame expected next. Empty if none
+  bool confirmed;		// the first block of the frame matches the prediction
   
   int timeout;			// timeout in sec
   int soundChannels;		// mono, stereo
+  pa_sample_format stream_format;	// format of the samples of the stream: float or 16 bit
+  vector<int16_t> raw;		// 16 bit samples read or written, converted from and to float
   
-  int sample_frequency;
+  int sample_frequency;		// sampling frequency of the decoder
+  int stream_frequency;		// sampling frequency of the stream. It differs from sample_frequency when decimating
+  bool decimation;		// decimate the input streams faster than 8 kHz
+  Cresampler resampler;
+  vector<float> capture;	// samples read from the stream before the decimation
+  double resampler_lag;		// delay in seconds of the last decimated sample with respect to the last one read
+  Csynth synth;			// minute played
+  Crandom random;		// noise, phase and delay of the minute played. Not copied: each object has its own stream
   double decision_threshold;	// decision threshold in dB
   bool adaptive_decision_threshold;
   int  window_length;
   double snr_level;
+  int noise_estimator;		// estimator of the noise level of the WDS (see Cnoise)
+  double noise_percentile;
+  double frame_score;		// minimum score of the frame detector. 0 = frame detection off
+  long long late_samples;	// samples read after the reference sample of the last frame or syncronisation
 
   int verbose_level;		// verbose level for debugging messages
   
@@ -82,7 +123,13 @@ class Csrc : public Crw {
   
   Clog lout, lerr;	// logs for output and error messages
   
-  std::chrono::high_resolution_clock::time_point sys_clock;
+  std::chrono::high_resolution_clock::time_point sys_clock;	// capture time of the first sample of the last block read
+  int block;			// samples (at the stream frequency) of the last block read
+  long latency;			// latency in microseconds of the input stream at the last reading
+  Chistogram reads;		// intervals between the readings of the stream in ms
+  std::chrono::high_resolution_clock::time_point last_read;
+  Cstats stats;			// time of the stages of decode() and play(), readings and events. Not copied: each object counts its own work
+  Cmetrics* metrics;		// health of the decoder exported. NULL if none. Not copied: only one decoder may update it
   
 public:
     Csrc();		/**< Default constructor */
@@ -94,7 +141,7 @@ public:
      * @param fc Sampling frequency
      * @param channels Channels: 1 = mono; 2 = stereo. Default: mono
      * @param device Name of the sound device. Leaving it NULL will choose the default sound card. The sound server is the one used as default.
-     * @param SampFormat Format of the samples. The SRC class expects float samples in the continues range [-1;1]. Please, don't change this parameter unless sure. On Intel machines the endianness is 'Little Endian'.
+     * @param SampFormat Format of the samples: float samples in the continues range [-1;1] (PA_SAMPLE_FLOAT32LE) or 16 bit samples (PA_SAMPLE_S16LE), converted to and from float. Please, don't use other formats. On Intel machines the endianness is 'Little Endian'.
      * @param appName Name of the application using the sound server. By default "SRC".
      * @return bool
      */
@@ -107,7 +154,7 @@ public:
      * @param fc Sampling frequency
      * @param channels Channels: 1 = mono; 2 = stereo. Default: mono
      * @param device Name of the sound device. Leaving it NULL will choose the default sound card. The sound server is the one used as default.
-     * @param SampFormat Format of the samples. The SRC class expects float samples in the continues range [-1;1]. Please, don't change this parameter unless sure. On Intel machines the endianness is 'Little Endian'.
+     * @param SampFormat Format of the samples: float samples in the continues range [-1;1] (PA_SAMPLE_FLOAT32LE) or 16 bit samples (PA_SAMPLE_S16LE), converted to and from float. Please, don't use other formats. On Intel machines the endianness is 'Little Endian'.
      * @param appName Name of the application using the sound server. By default "SRC".
      * @return bool
      */
@@ -137,9 +184,10 @@ public:
      * @param fileNAme Name of the file
      * @param fc Sampling frequency
      * @param channels Channels: 1 = mono; 2 = stereo.
+     * @param SampFormat Format of the samples: PA_SAMPLE_FLOAT32LE (default) or PA_SAMPLE_S16LE. The 16 bit samples are converted from float while writing.
      * @return bool
      */
-    bool open_file_output(const char* fileNAme, int fc, int channels);
+    bool open_file_output(const char* fileNAme, int fc, int channels, pa_sample_format SampFormat = PA_SAMPLE_FLOAT32LE);
     
     
     
@@ -149,9 +197,10 @@ public:
      * @param fileNAme Name of the file
      * @param fc Sampling frequency
      * @param channels Channels: 1 = mono; 2 = stereo.
+     * @param SampFormat Format of the samples: PA_SAMPLE_FLOAT32LE (default) or PA_SAMPLE_S16LE. The 16 bit samples are converted to float while reading.
      * @return bool
      */
-    bool open_file_input(const char* fileNAme, int fc, int channels);
+    bool open_file_input(const char* fileNAme, int fc, int channels, pa_sample_format SampFormat = PA_SAMPLE_FLOAT32LE);
     
     
     
@@ -173,6 +222,29 @@ public:
      * @return int number of samples read
      */
     int readBuffer(float* buffer, int samples);
+
+
+   /**
+     * @brief Read the 16 bit samples of the input stream as they are, the channels averaged. Only for 16 bit streams
+     * at the rate of the decoder (see s16_input()).
+     *
+     * @param buffer Pointer to sampling data (full scale 32768)
+     * @param samples Number of samples
+     * @return int number of samples read; -1 if the stream is not 16 bit at the rate of the decoder
+     */
+    int readBuffer(int16_t* buffer, int samples);
+
+    bool s16_input() const { return (stream_format == PA_SAMPLE_S16LE) && (stream_frequency == sample_frequency); }	/**< Return true if the input stream can be decoded on its 16 bit samples */
+
+
+   /**
+     * @brief Read raw frames from the input stream if it is open, without averaging the channels nor decimating.
+     *
+     * @param buffer Pointer to sampling data. Its size must be frames times the number of channels
+     * @param frames Number of frames (one sample for each channel, interleaved)
+     * @return int number of frames read
+     */
+    int readFrames(float* buffer, int frames);
     
     
     
@@ -191,6 +263,15 @@ public:
      * @param noise_sigma RMS of the Additive White Gaussian Noise added to the main signal
      */
     void play(double power = -3, bool initial_delay = false, bool random_theta = false, double noise_sigma = 0.0);
+
+    /**
+     * @brief Seed the random numbers of play() (noise, theta and initial delay), so the minutes played can be reproduced.
+     *        By default each object is seeded from the random device of the system
+     *
+     * @param seed Seed
+     * @param stream Independent stream of the same seed, e.g. one for each thread
+     */
+    void set_seed(uint64_t seed, unsigned int stream = 0) { random.seed(seed, stream); }
     
     bool warnings() const { return (change_time != 7) || (leap_second != 0); }	/**< Return true if there is any warning issued. */
     
@@ -231,6 +312,7 @@ public:
 
     void set_today();		/**< The internal variables are set to the current date and time */
     void reset();		/**< Reset all the variables the default and close all the stream */
+    void start() { running = true; }	/**< Allow readBuffer() and readFrames() outside decode(), e.g. to feed another decoder */
     void stop();		/**< Any action on streams are stopped. */
     bool streamOK() const { return streamON; }	/**< Return the state of the stream. A 0 is returned for invalid input or output streams. */
 
@@ -238,6 +320,7 @@ public:
     
     int	get_timeout() const { return timeout; }	/**< Return the decoding timeout in seconds */
     void set_timeout(int seconds);		/**< Set the decoding timeout in seconds */
+    void set_metrics(Cmetrics* m) { metrics = m; }	/**< Export the health of the decoder on m (NULL = none, default) */
 
 
 
@@ -266,11 +349,93 @@ public:
     int setWDS(int Wlength, double snr = 12.0);
 
 
+    /**
+     * @brief Set the estimator of the noise level used by the Window Decision System
+     *
+     * The decision threshold is set snr dB over the noise level of the last symbols, estimated as their mean
+     * (default), as an exponentially weighted moving average or as a percentile (see Cnoise). The percentile,
+     * e.g. the median, is not raised by short bursts of program audio.
+     *
+     * @param estimator One of Cnoise_type: NOISE_MEAN, NOISE_EWMA, NOISE_PERCENTILE
+     * @param percentile Percentile in the range (0, 1) for NOISE_PERCENTILE. Default: 0.5, the median
+     */
+    void set_noise_estimator(int estimator, double percentile = 0.5);
+    int get_noise_estimator() const { return noise_estimator; }	/**< Return the estimator of the noise level of the WDS */
+
 
 
 
+
+    /**
+     * @brief Acquire the frame through the matched filter detector instead of waiting symbol by symbol for the tones
+     *
+     * The incoming stream is correlated with the known structure of the beginning of the frame (see Cdetector). Each
+     * candidate frame found by the detector is decoded as a whole, so a false trigger does not reset the acquisition.
+     *
+     * @param score Minimum correlation score of the candidates in the range (0, 1], e.g. 0.5. Zero or negative values disable the frame detection
+     */
+    void set_frame_detection(double score);
+    double get_frame_detection() const { return frame_score; }	/**< Return the minimum score of the frame detector (0 = off) */
+
+
+
+    /**
+     * @brief Decimate the input streams to 8 kHz before decoding
+     *
+     * Input streams opened afterwards at a rate higher than 8 kHz (e.g. 44.1 or 48 kHz) are filtered and decimated by
+     * a polyphase filter (see Cresampler), so the decoder always works on 8000 samples per second. The group delay of
+     * the filter is compensated in the timing of the syncronisation (see microsecDelay()).
+     *
+     * @param on True to decimate
+     */
+    void set_decimation(bool on) { decimation = on; }
+    bool get_decimation() const { return decimation; }	/**< Return true if the input streams are decimated */
+    int get_sample_frequency() const { return sample_frequency; }	/**< Return the sampling frequency of the decoder (8000 Hz when decimating) */
+
+
+
+    /**
+     * @brief Correct the frames that fail the checks by flipping the weakest bits
+     *
+     * The soft value log(P1/P0) of every symbol is kept. When a frame fails the checks of the IDs, of the parities or of
+     * the date and no more than bits symbols are uncertain (decided within 6 dB), the uncertain bits are flipped: among
+     * the combinations passing all the checks, the one flipping the least total confidence is taken. While acquiring the frame symbol by symbol, up to bits
+     * symbols under threshold are decided anyway and the parity errors are left to the correction.
+     *
+     * @param bits Maximum number of bits corrected in a frame [0, 4]. 0 = no correction (default)
+     */
+    void set_corrections(int bits);
+    int get_corrections() const { return corrections; }	/**< Return the maximum number of bits corrected in a frame */
+    int corrected_bits() const { return corrected; }	/**< Return the number of bits corrected in the last frame decoded */
+
+    /**
+     * @brief Return the confidence of the last frame decoded: the margin in dB between the powers of F0 and F1 of its weakest symbol.
+     *
+     * The margin of the bits corrected is counted as negative, so a positive value means that no bit has been corrected.
+     */
+    double get_confidence() const { return confidence; }
+
+
+    /**
+     * @brief Track the frames predicting the next one
+     *
+     * Once a frame is decoded, the frame of the next minute is predicted by add_minute() and encode(). When the first
+     * block received matches the prediction, but for up to get_corrections() uncertain bits, the minute is confirmed;
+     * the second block is still decoded and replaces the predicted one only if the bits that differ are certain and the
+     * frame is valid (e.g. a warning of change of time not predicted). While a prediction
+     * is available a few symbols under threshold are decided by their soft value instead of resetting the acquisition.
+     * A missed frame drops the prediction.
+     *
+     * @param on Tracking on/off
+     * @param clock Without a prediction (e.g. at the first decoding), predict the frame from the system clock, whose
+     *              local time zone is assumed to be the one of the SRC (CET/CEST)
+     */
+    void set_tracking(bool on, bool clock = false);
+    bool tracked() const { return confirmed; }	/**< Return true if the first block of the last frame has been confirmed by the prediction */
+
+
     double set_decision_threshold(double dB);		/**< Set the value in dB of the decision threshold */
-    inline double get_decision_threshold() const;	/**< Return the value of the decision threshold in dB */
+    double get_decision_threshold() const { return 10*log10(decision_threshold); }	/**< Return the value of the decision threshold in dB */
 
 
 
@@ -295,6 +460,10 @@ public:
     void set_verbose(int level) { verbose_level = level; }
     int get_verbose() const { return verbose_level; }	/**< Return the verbose level */
 
+    const Cstats& get_stats() const { return stats; }	/**< Return the time spent in each stage of decode() and play(), the readings and the events of the decoder */
+    void set_timing(bool on) { stats.enable(on); }	/**< Time the stages and the readings in get_stats() (on by default) */
+    void log_stats(bool always = false);	/**< Log the summary of get_stats() (verbose level 2 or more, or always) */
+
     
     static bool leapyear(int y);	/**< Return true if the year has 366 days */
     
@@ -318,6 +487,7 @@ public:
     void logOnFile(const char* fileName);	/**< The log are redirect on external file */
     void errorLogOnFile(const char* fileName);	/**< Errors log are redirect on external file */
     void logOnSTDOUT();				/**< Set the default STDOUT stream for logs */
+    void logAsync(bool on);			/**< The logs are queued and written by a background thread (see Clog) */
     
 
 
@@ -375,15 +545,27 @@ public:
     /**
       * @brief Return the microseconds elapsed since last reading from the input stream.
       *
-      * This function is useful to perform fine sincronisation of the system clock. Each time some samples are read
-      * from the input stream the internal timing variable is reset and the computational delay can be calculated
-      * through this function. Essentially, once the SRC signal has been received the system clock is set to the
+      * This function is useful to perform fine sincronisation of the system clock. Each block of samples read from the
+      * input stream is stamped with the time of capture of its first sample: the time of the reading less the samples
+      * of the block and the latency of the sound server (see get_latency()), so the time spent by the samples in the
+      * buffers of the server is counted as well. Essentially, once the SRC signal has been received the system clock is set to the
       * current date/time decoded plus the milliseconds and microseconds elapsed since last reading. The precision
       * can be of the orther of few microseconds depending on the machine's hardware.
+      * The sub-sample offset of the last alignment of the tones is taken into account as well.
       *
       */
     long microsecDelay() const;
 
+    /**
+      * @brief Return the system time (seconds since the epoch) of the capture of the reference second of the date.
+      *
+      * It is the instant measured by microsecDelay(), taken from the stamp of the samples instead of the current time:
+      * the sample where the last RP ended, so it does not depend on when it is called. The true time of that instant
+      * is the date decoded plus getMilliseconds().
+      */
+    double reference_time() const;
+
+    long get_latency() const { return latency; }	/**< Return the latency in microseconds of the input stream at the last reading. 0 for files */
     int getMilliseconds() const { return msec;}	/**< Return the number of milliseconds after last reference second */
 
 
@@ -393,23 +575,30 @@ public:
 // private functions:
 private:
 
-  double randn(double mu, double sigma);
   int parity(int beg, int end) const;
   void bin_convert(int val, int offset, int length);	// converts from an integer value to bit
   int deconvert(int offset, int length);
-  inline void checkSample(float& s);
-  inline void stereo_encode(float* p, int k);
   void encode();	// build the src_vector
   
   
-  double goertzel(int frequency, const float* data, int samples) const;		// calculates the power associated to a given frequency with the Goertzel algorithm
-  int read_buffer(float* b, int total_size, int& bytes2read, int& extra);	// modified function for reading the buffer
-  int tuning(int freq, float* buffer, int& extra, int N, int DELTA, int STEP, double& p);
-  static void reset_buffer(float* b, int size, float value = 0.0);
+  void set_stream_frequency(int fc);	// sets the rate of the stream and the one of the decoder
+  int read_decimated(float* buffer, int samples);
+  int read_stream(float* buffer, int samples);		// reads samples in the format of the stream
+  int write_stream(const float* buffer, int samples);
+  bool frame_decode();		// extracts the date from the 48 symbols of src_vector
+  bool frame_correct();		// frame_decode() with the correction of the weakest symbols and the confidence of the frame
+  void frame_confidence(int bits);	// confidence of the first bits of the frame
+  void predict(bool clock);	// predicts the frame following the date, or the next one from the system clock
+  bool match_prediction();	// compares the first block with the prediction
+  bool frame_predicted();	// completes a confirmed frame with the second block of the prediction
+  void stamp(int samples);	// stamps the block of samples just read
+  void reset_reads();		// the distribution of the intervals between the readings starts again
+  void log_reads();		// logs the distribution of the intervals between the readings of a sound stream
+  std::chrono::high_resolution_clock::time_point last_sample() const { return sys_clock + std::chrono::microseconds(block*1000000ll/stream_frequency); }	// capture time of the last sample read
+  static void reset_buffer(float* b, int size, float value = 0.0) { for(int i = 0; i < size; i++) b[i] = value; }
   static string itos(int value, int length = 1, int base = 10, char fill = '0', bool force_sign = false);
   void add_minute();
-  inline double max(double a, double b) const;
-  inline void reset_src_vector();
+  void reset_src_vector() { for(int i = 0; i < 48; i++) src_vector[i] = -1; confirmed = false; }	// put all elements with an error value
 };
 
 #endif // CSRC_H
@@ -0,0 +1,194 @@
+/*
+    Class Cstats - Implementation.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "cstats.h"
+#include "cdecoder.h"
+#include "clog.h"
+
+
+#define CALIBRATION	2000	// us spent measuring the ticks of the counter
+
+
+
+Cstats::Cstats()
+{
+  scale = calibrate();
+  on = true;
+
+  reset();
+}
+
+
+void Cstats::reset()
+{
+  for(int s = 0; s < STAGES; s++) {
+    time[s].reset();
+    calls[s] = 0;
+  }
+  reads = requested = read_max = 0;
+  samples = frames = syncs = timeouts = 0;
+  for(int i = 0; i < STATS_ERRORS; i++) resets[i] = 0;
+  since = std::chrono::steady_clock::now();
+  last = now();
+  timed = false;		// until mark() or block()
+  skip = 1;			// the first block is timed
+}
+
+
+
+void Cstats::Cbuckets::reset()
+{
+  for(int i = 0; i < SIZE; i++) bins[i] = 0;
+  n = 0;
+  sum = high = 0;
+}
+
+
+double Cstats::Cbuckets::percentile(double q) const
+{
+  long long k = (long long)(q*n);
+  int i;
+
+  if(n == 0) return 0.0;
+  if(k >= n) k = n - 1;
+
+  for(i = 0; i < SIZE; i++) {
+    if((long long)(bins[i]) > k) break;
+    k -= bins[i];
+  }
+
+  if(i < SUB) return i + 1;
+  const int e = i/SUB + 2;	// the bucket i holds [(SUB + m) << (e - 3), (SUB + m + 1) << (e - 3))
+  const double upper = double((SUB + i % SUB + 1)) * double(1ull << (e - 3));
+  return (upper < high) ? upper : high;
+}
+
+
+
+// The counter is compared with steady_clock once for the whole program
+double Cstats::calibrate()
+{
+#ifdef SRC_X86
+  static const double us = []() {
+    const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    const uint64_t c0 = now();
+    std::chrono::steady_clock::time_point t1;
+
+    do t1 = std::chrono::steady_clock::now();
+    while(std::chrono::duration<double, std::micro>(t1 - t0).count() < CALIBRATION);
+
+    return std::chrono::duration<double, std::micro>(t1 - t0).count()/(now() - c0);
+  }();
+
+  return us;
+#else
+  return 1e-3;
+#endif
+}
+
+
+
+void Cstats::event(int type, int value)
+{
+  switch(type) {
+    case EVENT_FRAME:	frames++;
+			break;
+    case EVENT_SYNC:	syncs++;
+			break;
+    case EVENT_TIMEOUT:	timeouts++;
+			break;
+    case EVENT_RESET:	resets[((value > 0) && (value < STATS_ERRORS)) ? value : 0]++;
+			break;
+    default:		break;
+  }
+}
+
+
+
+Cstats_snapshot Cstats::snapshot() const
+{
+  Cstats_snapshot s;
+
+  for(int k = 0; k < STAGES; k++) {
+    const Cbuckets& h = time[k];
+    Cstage_snapshot& t = s.stage[k];
+
+    t.calls = calls[k];
+    t.timed = h.n;
+    t.total = h.mean()*calls[k]*scale/1000.0;
+    t.mean = h.mean()*scale;
+    t.median = h.percentile(0.5)*scale;
+    t.p99 = h.percentile(0.99)*scale;
+    t.max = h.high*scale;
+  }
+
+  s.samples = samples;
+  s.reads = reads;
+  s.read_mean = (reads > 0) ? double(requested)/reads : 0.0;
+  s.read_max = read_max;
+  s.frames = frames;
+  s.syncs = syncs;
+  s.timeouts = timeouts;
+  for(int i = 0; i < STATS_ERRORS; i++) s.resets[i] = resets[i];
+  s.elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - since).count();
+
+  return s;
+}
+
+
+void Cstats::summary(Clog& log) const
+{
+  const Cstats_snapshot s = snapshot();
+  long long resets = 0;
+
+  if(on) {
+    log <<"Stages in " <<s.elapsed <<" s (calls, timed; total ms; mean, median, 99%, max us):\n";
+    for(int k = 0; k < STAGES; k++) {
+      const Cstage_snapshot& t = s.stage[k];
+      if(t.calls == 0) continue;
+
+      log <<"  " <<name(k) <<": " <<t.calls <<", " <<t.timed <<"; " <<t.total <<" ms; " <<t.mean <<", " <<t.median <<", " <<t.p99 <<", " <<t.max <<'\n';
+    }
+
+    if(s.reads == 0) return;	// nothing decoded
+    log <<"Samples read: " <<s.samples <<" in " <<s.reads <<" readings (mean " <<s.read_mean <<", max " <<s.read_max <<"); ";
+  }
+  else {
+    if(s.frames + s.syncs + s.timeouts == 0) return;
+    log <<"Decoder: ";
+  }
+
+  log <<"frames " <<s.frames <<", syncronised " <<s.syncs <<", timeouts " <<s.timeouts;
+  for(int i = 0; i < STATS_ERRORS; i++) resets += s.resets[i];
+  if(resets > 0) {
+    log <<"; resets:";
+    for(int i = 1; i < STATS_ERRORS; i++)
+      if(s.resets[i] > 0) log <<' ' <<s.resets[i] <<" (error " <<i <<')';
+    if(s.resets[0] > 0) log <<' ' <<s.resets[0] <<" (other errors)";
+  }
+  log <<'\n';
+}
+
+
+const char* Cstats::name(int stage)
+{
+  const char* names[] = {"read", "acquire", "frame", "tuning", "sync", "render", "write"};
+
+  return ((stage >= 0) && (stage < STAGES)) ? names[stage] : "";
+}
@@ -0,0 +1,170 @@
+/*
+    Class Cstats - Part of the SRCclock program.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CSTATS_H
+#define CSTATS_H
+
+
+#include <chrono>
+#include <cstdint>
+#include "csimd.h"
+
+
+class Clog;
+
+
+
+/**
+ * @brief Stages of the decoding and of the playing timed by Cstats
+ */
+enum Cstats_stage {
+  STAGE_READ,		/**< Reading of the input stream (waiting for the sound server), decimation included */
+  STAGE_ACQUIRE,	/**< Symbol by symbol acquisition of the frame: Goertzel of F0 and F1, WDS, checks */
+  STAGE_FRAME,		/**< Acquisition of the frame through the matched filter detector */
+  STAGE_TUNING,		/**< Alignment of the first symbol of a block or of the first RP. Counted in acquire and sync as well */
+  STAGE_SYNC,		/**< Syncronisation with the RP */
+  STAGE_RENDER,		/**< play(): frame, RP and noise */
+  STAGE_WRITE,		/**< play(): writing on the output stream */
+  STAGES
+};
+
+
+#define STATS_ERRORS	8	// error codes of Csrc::check() counted by Cstats
+#define STATS_SAMPLING	16	// one block of the stream out of STATS_SAMPLING is timed
+
+
+
+/**
+ * @brief Times of a stage in a Cstats_snapshot
+ */
+struct Cstage_snapshot {
+  long long calls;	/**< Number of calls */
+  long long timed;	/**< Number of calls timed */
+  double total;		/**< Total time in ms, estimated from the calls timed */
+  double mean, median, p99, max;	/**< Time of a call timed in us. The percentiles are rounded up to their bucket (12.5% at most) */
+};
+
+
+/**
+ * @brief Copy of the counts of Cstats
+ */
+struct Cstats_snapshot {
+  Cstage_snapshot stage[STAGES];	/**< Times of each Cstats_stage */
+  long long samples;		/**< Samples read from the input stream (at the rate of the decoder) */
+  long long reads;		/**< Calls reading the input stream */
+  double read_mean, read_max;	/**< Samples requested by a reading */
+  long long frames;		/**< Frames decoded */
+  long long syncs;		/**< Minutes syncronised */
+  long long timeouts;		/**< Timeouts of the frame or of the syncronisation */
+  long long resets[STATS_ERRORS];	/**< Resets of the acquisition by error code of Csrc::check(). resets[0] counts the codes out of range */
+  double elapsed;		/**< Seconds since the counts started */
+};
+
+
+
+/**
+ * @brief Instrumentation of decode() and play(): time spent in each stage, readings of the stream, events of the decoder.
+ *
+ * The stages are timed by the time stamp counter of the CPU where available (steady_clock elsewhere), calibrated once
+ * against steady_clock. The stages of a loop follow one another, so each one is timed as a lap from the end of the
+ * previous one: one reading of the counter for each stage. The times are counted in ticks of the counter by histograms
+ * of logarithmic buckets, 8 for each power of two (as HdrHistogram does, the percentiles are within 12.5% over any
+ * range, and the mean and the maximum are exact): an update is a few integer operations and needs no division.
+ * snapshot() copies the counts for other programs; summary() logs them. The counts are not synchronised: they are
+ * updated and read by the thread of the decoder.
+ *
+ * The unit of the decoding is the block: one reading of the stream and the feed() of the decoder that follows it, a
+ * symbol or so. A reading of the counter costs 20-30 ns on a virtual machine, as much as 1% of a block of a file
+ * decoded at 8 kHz, so only one block out of STATS_SAMPLING is timed (see block()): the other ones are just counted,
+ * and the totals are estimated from the mean of the blocks timed. The minutes of play() are all timed (see mark()).
+ * The timing costs less than 1% of the decoding of a file and is on by default.
+ *
+ * @class Cstats
+ * @author Vittorio Tornielli di Crestvolant   <vittorio.tornielli@gmail.com>
+ * @version 1.0
+ * @date 2009-2014
+ */
+
+class Cstats {
+    struct Cbuckets {		// logarithmic histogram of integer values
+      enum { SUB = 8, SIZE = 62*SUB };	// buckets for each power of two; buckets up to 2^64
+      uint64_t bins[SIZE];
+      long long n;
+      uint64_t sum, high;
+
+      void reset();
+      void add(uint64_t x)
+      {
+        const int e = 63 - __builtin_clzll(x | 1);
+        bins[(e < 3) ? int(x) : (e - 2)*SUB + int((x >> (e - 3)) & (SUB - 1))]++;
+        n++;
+        sum += x;
+        if(x > high) high = x;
+      }
+      double mean() const { return (n > 0) ? double(sum)/n : 0.0; }
+      double percentile(double q) const;	// upper edge of the bucket
+    };
+
+    Cbuckets time[STAGES];	// ticks of each call timed
+    long long calls[STAGES];	// calls of each stage, timed or not
+    long long reads, requested, read_max;	// readings of the stream and samples requested
+    long long samples;
+    long long frames, syncs, timeouts;
+    long long resets[STATS_ERRORS];
+    std::chrono::steady_clock::time_point since;
+    double scale;		// us for each tick of now()
+    uint64_t last;		// end of the last stage counted by lap()
+    bool on;			// timing of the stages and of the readings
+    bool timed;			// the stages of the current block are timed
+    int skip;			// blocks before the next one timed
+
+public:
+    Cstats();
+
+    void reset();		/**< Start the counts again */
+    void enable(bool timing) { on = timing; timed = false; }	/**< Switch the timing of the stages and of the readings on (default) or off */
+    bool enabled() const { return on; }		/**< Return true if the stages and the readings are timed */
+
+    static uint64_t now()	/**< Return the current tick of the counter timing the stages */
+    {
+#ifdef SRC_X86
+      return __builtin_ia32_rdtsc();
+#else
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    uint64_t start() const { return timed ? now() : 0; }	/**< Return the tick starting a stage counted by add() */
+    void mark() { timed = on; if(timed) last = now(); }	/**< Start the stages counted by lap(), all timed */
+    void block() { if(on && (timed = (--skip == 0))) { skip = STATS_SAMPLING; last = now(); } }	/**< Start the stages of a block of the stream, timed once every STATS_SAMPLING blocks */
+    void lap(int stage) { if(!on) return; calls[stage]++; if(!timed) return; const uint64_t t = now(); time[stage].add(t - last); last = t; }	/**< Count a call of the stage ending now, started at the end of the previous one, at mark() or at block() */
+    void add(int stage, uint64_t start) { if(!on) return; calls[stage]++; if(timed) time[stage].add(now() - start); }	/**< Count a call of a stage nested in another one, started at the tick start */
+    void read(int want, int got) { if(!on) return; reads++; if(want > 0) { requested += want; if(want > read_max) read_max = want; } if(got > 0) samples += got; }	/**< Count a reading of the stream */
+    void event(int type, int value);	/**< Count an event of the decoder (see Cevent_type) */
+
+    Cstats_snapshot snapshot() const;	/**< Return a copy of the counts */
+    void summary(Clog& log) const;	/**< Log a summary of the counts, one line for each stage */
+
+    static const char* name(int stage);	/**< Return the name of the stage */
+
+private:
+    static double calibrate();	// us for each tick
+};
+
+#endif // CSTATS_H
@@ -0,0 +1,209 @@
+/*
+    Class Csynth - Implementation.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cmath>
+#include <cstring>
+#include "csynth.h"
+#include "csimd.h"
+
+
+
+Csynth::Csynth()
+{
+  fs = 8000;
+  amplitude = 1.0;
+  theta = 0.0;
+  length = 0;
+}
+
+
+void Csynth::set(int sample_frequency, double amp, double phase)
+{
+  if((sample_frequency != fs) || (amp != amplitude) || (phase != theta)) tables.clear();
+
+  fs = sample_frequency;
+  amplitude = amp;
+  theta = phase;
+}
+
+
+
+// the samples are the ones of amplitude*cos(2 pi f k/fs + theta) computed in double, as the tones have always been
+const std::vector<float>& Csynth::table(int freq, int samples)
+{
+  std::vector<float>& t = tables[freq];
+  const int old = t.size();
+
+  if(old < samples) {
+    t.resize(samples);
+    for(int k = old; k < samples; k++) t[k] = amplitude*cos(2.0*M_PI*freq/fs*k + theta);
+  }
+
+  return t;
+}
+
+
+float* Csynth::grow(int samples)
+{
+  if(int(minute.size()) < length + samples) minute.resize(length + samples);
+  length += samples;
+
+  return &minute[length - samples];
+}
+
+
+void Csynth::tone(int freq, int samples)
+{
+  if(samples <= 0) return;
+
+  const std::vector<float>& t = table(freq, samples);
+  memcpy(grow(samples), &t[0], samples*sizeof(float));
+}
+
+
+void Csynth::silence(int samples)
+{
+  if(samples <= 0) return;
+
+  memset(grow(samples), 0, samples*sizeof(float));
+}
+
+
+
+const float* Csynth::interleave(int channels)
+{
+  float* x = data();
+
+  clip(x, length);
+  if(channels <= 1) return x;
+
+  if(int(frames.size()) < length*channels) frames.resize(length*channels);
+  interleave(x, length, channels, &frames[0]);
+
+  return &frames[0];
+}
+
+
+void Csynth::interleave(const float* x, int n, int channels, float* out)
+{
+  if(channels == 2) {
+    switch(simd_level()) {
+      case 2:	stereo_avx2(x, n, out);
+		break;
+      case 1:	stereo_sse(x, n, out);
+		break;
+      default:	for(int i = 0; i < n; i++) out[2*i] = out[2*i + 1] = x[i];
+    }
+  }
+  else {
+    for(int i = 0; i < n; i++)
+      for(int c = 0; c < channels; c++) out[i*channels + c] = x[i];
+  }
+}
+
+
+void Csynth::clip(float* x, int n)
+{
+  switch(simd_level()) {
+    case 2:	clip_avx2(x, n);
+		break;
+    case 1:	clip_sse(x, n);
+		break;
+    default:	for(int i = 0; i < n; i++) x[i] = (x[i] < -1.0f) ? -1.0f : ((x[i] > 1.0f) ? 1.0f : x[i]);
+  }
+}
+
+
+#ifdef SRC_X86
+
+__attribute__((target("sse")))
+void Csynth::clip_sse(float* x, int n)
+{
+  const __m128 lo = _mm_set1_ps(-1.0f), hi = _mm_set1_ps(1.0f);
+  int i = 0;
+
+  for(; i + 4 <= n; i += 4) _mm_storeu_ps(x + i, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(x + i), lo), hi));
+  for(; i < n; i++) x[i] = (x[i] < -1.0f) ? -1.0f : ((x[i] > 1.0f) ? 1.0f : x[i]);
+}
+
+
+__attribute__((target("avx2")))
+void Csynth::clip_avx2(float* x, int n)
+{
+  const __m256 lo = _mm256_set1_ps(-1.0f), hi = _mm256_set1_ps(1.0f);
+  int i = 0;
+
+  for(; i + 8 <= n; i += 8) _mm256_storeu_ps(x + i, _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(x + i), lo), hi));
+  for(; i < n; i++) x[i] = (x[i] < -1.0f) ? -1.0f : ((x[i] > 1.0f) ? 1.0f : x[i]);
+}
+
+
+__attribute__((target("sse")))
+void Csynth::stereo_sse(const float* x, int n, float* out)
+{
+  int i = 0;
+
+  for(; i + 4 <= n; i += 4) {
+    const __m128 v = _mm_loadu_ps(x + i);
+    _mm_storeu_ps(out + 2*i, _mm_unpacklo_ps(v, v));
+    _mm_storeu_ps(out + 2*i + 4, _mm_unpackhi_ps(v, v));
+  }
+  for(; i < n; i++) out[2*i] = out[2*i + 1] = x[i];
+}
+
+
+// unpacklo/hi work within the 128 bit lanes: the pairs of x0..x3 and x4..x7 are regrouped by the permutes
+__attribute__((target("avx2")))
+void Csynth::stereo_avx2(const float* x, int n, float* out)
+{
+  int i = 0;
+
+  for(; i + 8 <= n; i += 8) {
+    const __m256 v = _mm256_loadu_ps(x + i);
+    const __m256 lo = _mm256_unpacklo_ps(v, v);	// x0 x0 x1 x1 | x4 x4 x5 x5
+    const __m256 hi = _mm256_unpackhi_ps(v, v);	// x2 x2 x3 x3 | x6 x6 x7 x7
+    _mm256_storeu_ps(out + 2*i, _mm256_permute2f128_ps(lo, hi, 0x20));
+    _mm256_storeu_ps(out + 2*i + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+  }
+  for(; i < n; i++) out[2*i] = out[2*i + 1] = x[i];
+}
+
+#else
+
+void Csynth::clip_sse(float* x, int n)
+{
+  for(int i = 0; i < n; i++) x[i] = (x[i] < -1.0f) ? -1.0f : ((x[i] > 1.0f) ? 1.0f : x[i]);
+}
+
+void Csynth::clip_avx2(float* x, int n)
+{
+  clip_sse(x, n);
+}
+
+void Csynth::stereo_sse(const float* x, int n, float* out)
+{
+  for(int i = 0; i < n; i++) out[2*i] = out[2*i + 1] = x[i];
+}
+
+void Csynth::stereo_avx2(const float* x, int n, float* out)
+{
+  stereo_sse(x, n, out);
+}
+
+#endif
@@ -0,0 +1,94 @@
+/*
+    Class Csynth - Part of the SRCclock program.
+    Copyright (C) 2014  Vittorio Tornielli di Crestvolant <vittorio.tornielli@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CSYNTH_H
+#define CSYNTH_H
+
+
+#include <vector>
+#include <map>
+
+
+
+/**
+ * @brief Synthesis of the SRC signal into one contiguous buffer.
+ *
+ * Every tone of the SRC (symbols and RP) starts with the same phase theta, so the tones of a frequency are all the
+ * same waveform: it is computed once in a wavetable, and each tone is a copy of its first samples. The signal is
+ * rendered mono in the buffer of the whole minute; the noise is added in place by the caller, then the samples are
+ * clipped to [-1, 1] and copied to every channel of the output. Clipping and interleaving are vectorized with SSE or
+ * AVX2 when available. The buffers grow to the longest minute and are reused.
+ *
+ * @class Csynth
+ * @author Vittorio Tornielli di Crestvolant   <vittorio.tornielli@gmail.com>
+ * @version 1.0
+ * @date 2009-2014
+ */
+
+class Csynth {
+    int fs;			// sampling frequency
+    double amplitude;
+    double theta;		// phase of the start of the tones
+    std::map<int, std::vector<float> > tables;	// one tone of each frequency, as long as the longest one played
+    std::vector<float> minute;	// mono signal
+    int length;			// samples rendered in minute
+    std::vector<float> frames;	// interleaved output
+
+public:
+    Csynth();
+
+
+    /**
+     * @brief Set the parameters of the tones. The wavetables are computed again when they change
+     *
+     * @param sample_frequency Sampling frequency
+     * @param amp Amplitude of the tones
+     * @param phase Phase of the start of each tone in radians
+     */
+    void set(int sample_frequency, double amp, double phase = 0.0);
+
+    void clear() { length = 0; }		/**< Start a new signal */
+    void tone(int freq, int samples);		/**< Append a tone of frequency freq */
+    void silence(int samples);			/**< Append silence */
+
+    float* data() { return minute.data(); }	/**< Return the mono signal rendered, e.g. to add the noise */
+    int size() const { return length; }		/**< Return the samples rendered */
+
+
+    /**
+     * @brief Clip the signal to [-1, 1] and copy it to every channel
+     *
+     * @param channels Number of channels of the output
+     * @return const float* interleaved frames (size() of them), valid till the next call
+     */
+    const float* interleave(int channels);
+
+    static void clip(float* x, int n);		/**< Clip n samples to [-1, 1] */
+    static void interleave(const float* x, int n, int channels, float* out);	/**< Copy n samples to every channel of out */
+
+private:
+    const std::vector<float>& table(int freq, int samples);	// wavetable of freq at least samples long
+    float* grow(int samples);			// room for samples more at the end of minute
+    static void clip_sse(float* x, int n);
+    static void clip_avx2(float* x, int n);
+    static void stereo_sse(const float* x, int n, float* out);
+    static void stereo_avx2(const float* x, int n, float* out);
+};
+
+#endif // CSYNTH_H
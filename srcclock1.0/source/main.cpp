@@ -35,11 +35,25 @@
 
 
 #include <iostream>
+#include <iomanip>
+#include <fstream>
 #include <string>
 #include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <memory>
 #include <getopt.h>
 #include <sys/time.h>
+#include <csignal>
 #include "csrc.h"
+#include "cscanner.h"
+#include "cchannels.h"
+#include "cengine.h"
+#include "ccorpus.h"
+#include "cclock.h"
+#include "cservo.h"
+#include "crefclock.h"
+#include "cmetrics.h"
 
 using std::cout;
 using std::cerr;
@@ -48,11 +62,16 @@ using std::cerr;
 // struct used to gather command line options
 struct SRCoption {
 	int SRCaction;
-	bool random_samples, random_theta,  do_sync, binary, iso, sys_sync;
-	int verb, chdate, leap, fc, channels, timeout, wds, repeat, dst;
-	double th, power, noise, snr_level;
+	bool random_samples, random_theta,  do_sync, binary, iso, sys_sync, decimate, scan, split, pool, s16, discipline, seeded, stats;
+	int verb, chdate, leap, fc, channels, timeout, wds, repeat, dst, threads, estimator, corrections, track, shm;
+	int corpus, corpus_threads;	// minutes of the corpus (0 = play one minute) and threads rendering it
+	int async_log;		// KB of the ring of each thread logging asyncronously. 0 = logs written directly
+	double th, power, noise, snr_level, frame, percentile;
+	double fragsize, tlength, prebuf;	// buffer attributes in ms. Negative = chosen by the server
+	double step;		// step threshold of the clock discipline in ms. 0 = never step
 	long delay;
-	char *soundDev, *fo, *logfile, *setDate;
+	unsigned long long seed;	// seed of the random numbers of the play
+	char *soundDev, *fo, *logfile, *setDate, *sock, *impair, *metrics;
 };
 	
 
@@ -61,21 +80,35 @@ struct SRCoption {
 void print_help(const char* filename)
 {
   cout  <<"Usage:\t" <<filename <<" --decode [OPTIONS]\n"
+	<<"or\t" <<filename <<" --pool=THREADS [OPTIONS] INPUT...\n"
 	<<"or\t" <<filename <<" --play [OPTIONS]\n"
 	<<"\nOption list:\n"
 	<<"  -d, --decode\t\tdecode SRC signal\n"
 	<<"  -y, --system-sync\tSyncronise the system clock to the SRC. Requires\n\t\t\tsuperuser privileges.\n"
+	<<"  -Z, --discipline[=STEP]\n\t\t\tdiscipline the system clock to the SRC of every\n\t\t\tminute (unlimited repetitions, with -s) by slewing\n\t\t\tits phase and frequency (adjtimex) instead of setting\n\t\t\tit. Offsets beyond STEP ms (default 128, 0 = never)\n\t\t\tstep the clock. Requires superuser privileges\n"
+	<<"  -U, --shm=UNIT\tpublish every minute syncronised (unlimited\n\t\t\trepetitions, with -s) on the SHM segment of the NTP\n\t\t\tunit UNIT for ntpd or chronyd (0 and 1 need root)\n"
+	<<"  -O, --sock=PATH\tsend every minute syncronised (as -U) to the socket\n\t\t\tPATH of a SOCK refclock of chronyd\n"
+	<<"  -H, --metrics=unix:PATH|FILE[,SECONDS]\n\t\t\texport the health of the decoder (frames decoded and\n\t\t\tfailed, threshold, noise, sync offset, RP power) in\n\t\t\tthe Prometheus text format on the Unix socket PATH,\n\t\t\tor rewriting FILE every SECONDS (default 15)\n"
 	<<"  -N, --snr=SNR_LEVEL\tSNR detection level over the noise in dB.\n\t\t\tDefault is SNR_LEVEL=5 dB abose noise level\n"
 	<<"  -W, --window=LENGTH\tWindow Decision System. Set the length of the window\n\t\t\tin time symbols. Default is LENGTH=50 symbols\n"
-	<<"  -D, --delay=DELAY\tdelay of syncronisation in microseconds\n"
+	<<"  -A, --estimator=EST\tnoise level of the Window Decision System: mean\n\t\t\t(default), ewma, median or a percentile [1-99]\n"
+	<<"  -D, --delay=DELAY\tfurther delay of syncronisation in microseconds. The\n\t\t\tlatency of the sound server is already compensated\n"
 	<<"  -T, --timeout=TIMEOUT\tset the timeout for decoding in seconds\n"
 	<<"  -t, --threshold=TH\tset static decision threshold in dB (default -35 dB)\n"
+	<<"  -B, --batch\t\tdecode every minute of the file (option -f) in\n\t\t\tparallel and print the sample offsets of the frames\n\t\t\tand of the syncronisation (with -s)\n"
+	<<"  -P, --pool=THREADS\tdecode all the INPUTs (files, pipes or pa:DEVICE for\n\t\t\ta sound device, pa: for the default one) on a pool\n\t\t\tof THREADS threads (0 = one for each core). Each\n\t\t\tINPUT is decoded -R times; the lines start with its ID\n"
+	<<"  -Y, --correct=BITS\tcorrect up to BITS [0-4] of the least confident bits\n\t\t\tof a frame failing the parity or the date checks\n\t\t\t(0 = off, default)\n"
+	<<"  -G, --track[=clock]\tpredict the frame of the next minute from the last one\n\t\t\tdecoded and confirm it from the first block (with\n\t\t\t-R). With clock, the first frame is predicted from\n\t\t\tthe system clock\n"
+	<<"  -F, --frame-detect=SCORE\n\t\t\tacquire the whole frame with the matched filter.\n\t\t\tSCORE is the minimum correlation score (0-1], e.g. 0.5\n\t\t\t(lower it for noisy signals)\n"
 	<<'\n'
 	<<"  -p, --play\t\tplay SRC signal\n"
 	<<"  -k, --rand-theta\tgives a random theta while playing\n"
 	<<"  -o, --rand-samples\tadd random samples (< 1 sec) before playing the signal\n"
 	<<"  -a, --power=POWER\tlevel of power of the wave in dB when playing\n"
 	<<"  -n, --noise=SIGMA\tplays the SRC with a given noise expressed as the RMS\n"
+	<<"  -g, --seed=SEED\tseed of the noise, of the random theta and of the\n\t\t\trandom samples: the same SEED plays the same signal\n\t\t\t(default: a random seed)\n"
+	<<"  -X, --corpus=MINUTES[,THREADS]\n\t\t\tgenerate MINUTES continuous minutes from the date of\n\t\t\t-S on THREADS threads (default one for each core), as\n\t\t\tfast as possible. Summer time and its warning follow\n\t\t\tthe calendar, -l inserts the leap second at the first\n\t\t\tend of month. With -f the labels of the minutes (frame\n\t\t\tand second 0 samples, date, SNR) go to FILE.labels\n"
+	<<"  -i, --impair=SPEC\timpairments of the channel of the corpus (only with\n\t\t\t-X), a list of: snr=DB[:DB...] (SNR of each minute,\n\t\t\tcyclic; replaces -n), offset=HZ (of the tones),\n\t\t\tphase=DEG (of the tones at their start, default 0),\n\t\t\tdrift=PPM (sampling clock), fade=DEPTH_DB[:PERIOD_S],\n\t\t\tprogram=FILE[:LEVEL_DB] (mono audio in the format of\n\t\t\tthe output, looped)\n\t\t\te.g. snr=20:10:5,phase=90,drift=50,fade=10:30\n"
 	<<"  -S, --set-date=DATE\tSet the SRC date time in the format <hh:mm DD/MM/YYYY>\n"
 	<<"  -e, --dst-on\t\tforce the dst flag (OE) to be 1\n"
 	<<"  -E, --dst-off\t\tforce the dst flag (OE) to be 0\n"
@@ -84,15 +117,22 @@ void print_help(const char* filename)
 	<<'\n'
 	<<"  -s, --sync\t\tsyncronisation with RP tones.\n\n"
 	<<"  -r, --rate=FREQ\tset the sample frequency (for input/output on files\n\t\t\tdefault is 8 kHz)\n"
+	<<"  -x, --decimate\tdecimate input streams faster than 8 kHz to 8 kHz\n\t\t\tbefore decoding (e.g. -r 48000 -x)\n"
 	<<"  -m, --mono\t\tsound stream is mono (1 channel). Default is stereo\n\t\t\t(2 channels)\n"
 	<<"  -M, --stero\t\tsound stream is stereo (2 channels). This is the\n\t\t\tdefault setting\n"
+	<<"  -K, --channels=CH\tdecode independently each of the CH channels [1-8]\n\t\t\tof the input stream instead of averaging them\n"
+	<<"  -Q, --s16\t\tsamples of the streams in signed 16 bit little endian\n\t\t\tformat instead of float (files, pipes and sound\n\t\t\tdevices, input and output)\n"
 	<<"  -f, --file=FILE\tselect source/destination file (default is sound server)\n"
 	<<"  -c, --card=DEV\tspecifies a different sound device\n"
+	<<"  -j, --latency=MS\task the sound server a latency of MS milliseconds\n\t\t\t(e.g. 10) for recording and playing\n"
+	<<"  -J, --buffer=FRAG[,TLEN[,PREBUF]]\n\t\t\tbuffer attributes of the sound streams in ms: fragment\n\t\t\tof recording, target length and prebuffering of\n\t\t\tplaying (-1 = chosen by the server). With -v 2 the\n\t\t\tintervals between the readings are logged\n"
 	<<"  -v, --debug=LEVEL\tverbose level (default 1)\n"
+	<<"  -z, --stats\t\tlog the time spent in each stage of the decoding and\n\t\t\tof the playing at the end, at any verbose level (from\n\t\t\t-v 2 it is always logged)\n"
 	<<"  -I, --iso\t\tPrint the date/time in the format ISO 8601\n\t\t\t(default: RFC2822 format)\n"
 	<<"  -b, --binary\t\tPrint the binary representation of the SRC signal\n"
-	<<"  -R, --repeat=TIMES\tNumber of decoding repetition (default = 1.\n\t\t\tSet 0 for unlimited repetitions)\n"
+	<<"  -R, --repeat=TIMES\tNumber of decoding repetition (default = 1, unlimited\n\t\t\twith -Z, -U and -O. Set 0 for unlimited repetitions)\n"
 	<<"  -L, --logfile=LOG\tredirect outputs to file log\n"
+	<<"  -u, --async-log[=KB]\tthe logs are written by a background thread: the\n\t\t\tdecoding queues them on a ring of KB kilobytes\n\t\t\t(default 256) and drops the ones not fitting\n"
 	<<"  -w, --warranty\twarranty details\n"
 	<<"  -V, --version\t\tversion of the program\n"
 	<<"  -h, --help\t\tprint this help then exits.\n\n";
@@ -112,6 +152,104 @@ void print_warranty()
 
 
 
+// syncronisation of the system clock to the date decoded by src. Returns the error of settimeofday()
+int sync_system_clock(const Csrc& src, long delay)
+{
+  struct timeval t;
+  struct timezone tz;	// timezone
+  tm ttmm;
+  int error;
+
+  tz.tz_minuteswest = 60*(1 + int(src.OE()));
+//tz.tz_dsttime = DST_MET;		// central europe dst time constant. For old systems....
+
+  ttmm = src.get_date_tm();	// 1) return the tm structure of the date/time
+  t.tv_sec  = mktime(&ttmm);	// 2) convert the current time to the number of seconds since the "epoc"
+// 3) set the number of microseonds. These are calculated taking into account the delay since the capture of the last sample read
+//    (latency of the sound server included) plus an uncertainty value
+  t.tv_usec = src.getMilliseconds()*1000l + src.microsecDelay() + delay;
+  t.tv_sec += t.tv_usec/1000000;	// the latency may exceed the second
+  t.tv_usec %= 1000000;
+
+  error = settimeofday(&t, &tz);
+  if(error == 0) cout <<"System clock updated!!\n" <<src.dateSTD() <<'\n';
+  else cerr <<"EE: Unable to syncronise the system clock.\n";
+
+  return error;
+}
+
+
+// discipline of the clock to the date decoded by src: offset measured as in sync_system_clock(), given to the servo and
+// corrected by slewing or stepping the clock. Returns 0 or -1 if the clock cannot be adjusted
+int discipline_clock(const Csrc& src, long delay, Cclock& clock, Cservo& servo, int verb)
+{
+  tm ttmm = src.get_date_tm();
+  const double reference = mktime(&ttmm) + (src.getMilliseconds()*1000l + src.microsecDelay() + delay)*1e-6;
+  const double offset = clock.offset(reference);
+  bool done = true;
+
+  switch(servo.update(offset, reference)) {
+    case SERVO_STEP:	done = clock.step(servo.get_step());
+			break;
+    case SERVO_SLEW:	done = clock.slew(servo.get_phase(), servo.get_frequency());
+			break;
+    default:		break;
+  }
+
+  if(!done) {
+    cerr <<"EE: Unable to adjust the system clock.\n";
+    return -1;
+  }
+
+  if(verb >= 1) {
+    cout <<"Offset: " <<std::fixed <<std::setprecision(1) <<offset*1e6 <<" us; frequency: " <<std::setprecision(3)
+	 <<clock.frequency()*1e6 <<" ppm; jitter: " <<std::setprecision(1) <<servo.get_jitter()*1e6 <<" us";
+    if(servo.get_step() != 0.0) cout <<"; clock stepped";
+    cout <<'\n';
+    cout.unsetf(std::ios::floatfield);
+    cout <<std::setprecision(6);
+    cout.flush();
+  }
+
+  return 0;
+}
+
+
+
+static volatile sig_atomic_t stopping = 0;	// SIGINT or SIGTERM received
+
+static void stop(int)
+{
+  stopping = 1;
+}
+
+
+
+// publication of the date decoded by src as a sample of the reference clock: the true time of the reference second
+// and the system time of its capture. Returns 0 or -1 if the sample has not been delivered
+int publish_sample(const Csrc& src, long delay, Crefclock& refclock, int verb)
+{
+  tm ttmm = src.get_date_tm();
+  const double clock = mktime(&ttmm) + (src.getMilliseconds()*1000l + delay)*1e-6;
+  const double receive = src.reference_time();
+
+  if(!refclock.publish(clock, receive, src.SI())) {
+    cerr <<"EE: Unable to deliver the sample to the reference clock.\n";
+    return -1;
+  }
+
+  if(verb >= 1) {
+    cout <<"Sample published: offset " <<std::fixed <<std::setprecision(1) <<(clock - receive)*1e6 <<" us\n";
+    cout.unsetf(std::ios::floatfield);
+    cout <<std::setprecision(6);
+    cout.flush();
+  }
+
+  return 0;
+}
+
+
+
 int main(int argc, char **argv) {
 
   Csrc SRC;
@@ -130,6 +268,23 @@ int main(int argc, char **argv) {
   options.binary = false;
   options.iso = false;
   options.sys_sync = false;
+  options.decimate = false;
+  options.scan = false;
+  options.split = false;
+  options.pool = false;
+  options.s16 = false;
+  options.discipline = false;
+  options.seeded = false;
+  options.stats = false;
+  options.seed = 0;
+  options.step = 128.0;
+  options.shm = -1;		// no SHM segment
+  options.corpus = 0;		// one minute played
+  options.corpus_threads = 0;
+  options.impair = '\0';
+  options.sock = '\0';
+  options.metrics = '\0';
+  options.threads = 0;
   options.dst = 0;		// default, set by system date
   options.verb = 1;		// normal verbose level
   options.chdate = 7;		// no change date
@@ -142,12 +297,19 @@ int main(int argc, char **argv) {
   options.timeout = 0;		// uses default
   options.wds = 50;
   options.snr_level = 5.0;	// 5 dB SNR default
+  options.frame = 0.0;		// frame detection off
+  options.estimator = NOISE_MEAN;
+  options.percentile = 0.5;
+  options.corrections = 0;
+  options.track = 0;		// no tracking
+  options.fragsize = options.tlength = options.prebuf = -1.0;	// buffers chosen by the sound server
   
   options.fo = '\0';
   options.soundDev = '\0';	// default sound device
   options.logfile = '\0';
+  options.async_log = 0;
   options.setDate = '\0';
-  options.repeat = 1;
+  options.repeat = -1;		// 1, unlimited for the long running modes
   options.SRCaction = 0;
   options.delay = 1;
 
@@ -165,6 +327,10 @@ int main(int argc, char **argv) {
 		{"decode",       no_argument,       NULL, 'd'},
 		{"play",         no_argument,       NULL, 'p'},
 		{"system-sync",  no_argument,       NULL, 'y'},
+		{"discipline",   optional_argument, NULL, 'Z'},
+		{"shm",          required_argument, NULL, 'U'},
+		{"sock",         required_argument, NULL, 'O'},
+		{"metrics",      required_argument, NULL, 'H'},
 		{"delay",        required_argument, NULL, 'D'},
 		{"rand-theta",   no_argument,       NULL, 'k'},
 		{"rand-samples", no_argument,       NULL, 'o'},
@@ -175,20 +341,36 @@ int main(int argc, char **argv) {
 		{"sync",         no_argument,       NULL, 's'},
 		{"file",         required_argument, NULL, 'f'},
 		{"debug",        required_argument, NULL, 'v'},
+		{"stats",        no_argument,       NULL, 'z'},
 		{"threshold",    required_argument, NULL, 't'},
+		{"frame-detect", required_argument, NULL, 'F'},
+		{"batch",        no_argument,       NULL, 'B'},
+		{"pool",         required_argument, NULL, 'P'},
 		{"noise",        required_argument, NULL, 'n'},
+		{"seed",         required_argument, NULL, 'g'},
+		{"corpus",       required_argument, NULL, 'X'},
+		{"impair",       required_argument, NULL, 'i'},
 		{"snr",          required_argument, NULL, 'N'},
 		{"window",       required_argument, NULL, 'W'},
+		{"estimator",    required_argument, NULL, 'A'},
+		{"correct",      required_argument, NULL, 'Y'},
+		{"track",        optional_argument, NULL, 'G'},
 		{"change-time",  required_argument, NULL, 'C'},
 		{"leap-second",  required_argument, NULL, 'l'},
 		{"rate",         required_argument, NULL, 'r'},
+		{"decimate",     no_argument,       NULL, 'x'},
 		{"mono",         no_argument,       NULL, 'm'},
 		{"stereo",       no_argument,       NULL, 'M'},
+		{"channels",     required_argument, NULL, 'K'},
 		{"card",         required_argument, NULL, 'c'},
+		{"latency",      required_argument, NULL, 'j'},
+		{"buffer",       required_argument, NULL, 'J'},
+		{"s16",          no_argument,       NULL, 'Q'},
 		{"iso",          no_argument,       NULL, 'I'},
 		{"binary",       no_argument,       NULL, 'b'},
 		{"timeout",      required_argument, NULL, 'T'},
 		{"logfile",      required_argument, NULL, 'L'},
+		{"async-log",    optional_argument, NULL, 'u'},
 		{"repeat",       required_argument, NULL, 'R'},
 		{"warranty",     no_argument,       NULL, 'w'},
 		{"version",      no_argument,       NULL, 'V'},
@@ -196,15 +378,53 @@ int main(int argc, char **argv) {
 		{0, 0, 0, 0}};
 
 
-  while((choice = getopt_long(argc, argv, "dypkoeEa:sf:v:t:N:W:n:C:l:c:mMr:D:R:T:L:S:bIhVw", long_options, &longindex)) != -1) {
+  while((choice = getopt_long(argc, argv, "dypkoeEa:sf:v:t:F:BP:N:W:A:Y:G::n:C:l:c:j:J:QmMK:r:xD:R:T:L:S:bIhVwZ::U:O:H:g:X:i:u::z", long_options, &longindex)) != -1) {
     switch (choice) {
       case 'd': options.SRCaction |= 1;		// SRCaction=1	=>	DECODE!
 		break;
       case 'y': options.sys_sync = true;
 		options.SRCaction |= 1;
 		break;
+      case 'Z': options.discipline = true;
+		if(optarg) options.step = atof(optarg);
+		if(options.step < 0.0) {
+		  cerr <<"EE: The step threshold must be positive (0 = never step). Setting default -> 128 ms\n";
+		  options.step = 128.0;
+		}
+		options.sys_sync = true;
+		options.do_sync = true;
+		options.SRCaction |= 1;
+		break;
+      case 'U': options.shm = atoi(optarg);
+		if(options.shm < 0) {
+		  cerr <<"EE: The SHM unit must be positive. Setting default -> 2\n";
+		  options.shm = 2;
+		}
+		options.do_sync = true;
+		options.SRCaction |= 1;
+		break;
+      case 'O': options.sock = optarg;
+		options.do_sync = true;
+		options.SRCaction |= 1;
+		break;
+      case 'H': options.metrics = optarg;
+		options.SRCaction |= 1;
+		break;
+      case 'g': options.seed = strtoull(optarg, NULL, 0);
+		options.seeded = true;
+		break;
       case 'p': options.SRCaction |= 2;		// SRCaction=2	=>	PLAY!
 		break;
+      case 'X': if(sscanf(optarg, "%d,%d", &options.corpus, &options.corpus_threads) < 1) options.corpus = 0;
+		if((options.corpus <= 0) || (options.corpus_threads < 0)) {
+		  cerr <<"EE: The corpus needs a positive number of minutes and of threads (0 = one for each core)\n";
+		  return 1;
+		}
+		options.SRCaction |= 2;
+		break;
+      case 'i': options.impair = optarg;
+		options.SRCaction |= 2;
+		break;
       case 'k': options.random_theta = true;
 		options.SRCaction |= 2;
 		break;
@@ -229,15 +449,63 @@ int main(int argc, char **argv) {
 		break;
       case 'v': options.verb = atoi(optarg);
 		break;
+      case 'z': options.stats = true;
+		break;
       case 't':	options.th = atof(optarg);
 		options.SRCaction |= 1;
 		break;
+      case 'F': options.frame = atof(optarg);
+		if((options.frame <= 0.0) || (options.frame > 1.0)) {
+		  cerr <<"EE: The score of the frame detector must be in the range (0-1]. Setting default -> 0.5\n";
+		  options.frame = 0.5;
+		}
+		options.SRCaction |= 1;
+		break;
+      case 'B': options.scan = true;
+		options.SRCaction |= 1;
+		break;
+      case 'P': options.threads = atoi(optarg);
+		if(options.threads < 0) {
+		  cerr <<"EE: The number of threads must be positive (0 = one for each core). Setting default -> 0\n";
+		  options.threads = 0;
+		}
+		options.pool = true;
+		options.SRCaction |= 1;
+		break;
       case 'N': options.snr_level = atof(optarg);
 		options.SRCaction |= 1;
 		break;
       case 'W': options.wds = atoi(optarg);
 		options.SRCaction |= 1;
 		break;
+      case 'A': options.percentile = 0.5;
+		if(strcmp(optarg, "mean") == 0) options.estimator = NOISE_MEAN;
+		else if(strcmp(optarg, "ewma") == 0) options.estimator = NOISE_EWMA;
+		else if(strcmp(optarg, "median") == 0) options.estimator = NOISE_PERCENTILE;
+		else if((atoi(optarg) >= 1) && (atoi(optarg) <= 99)) {
+		  options.estimator = NOISE_PERCENTILE;
+		  options.percentile = atoi(optarg)/100.0;
+		}
+		else {
+		  cerr <<"EE: The noise estimator must be mean, ewma, median or a percentile [1-99]. Setting default -> mean\n";
+		  options.estimator = NOISE_MEAN;
+		}
+		options.SRCaction |= 1;
+		break;
+      case 'Y': options.corrections = atoi(optarg);
+		if((options.corrections < 0) || (options.corrections > 4)) {
+		  cerr <<"EE: The bits corrected must be in the range [0-4]. Setting default -> 0\n";
+		  options.corrections = 0;
+		}
+		options.SRCaction |= 1;
+		break;
+      case 'G': options.track = 1;
+		if(optarg) {
+		  if(strcmp(optarg, "clock") == 0) options.track = 2;
+		  else cerr <<"EE: Unknown argument of the tracking: " <<optarg <<". The frames are predicted from the last one\n";
+		}
+		options.SRCaction |= 1;
+		break;
       case 'n': options.noise = atof(optarg);
 		options.SRCaction |= 2;
 		break;
@@ -261,12 +529,36 @@ int main(int argc, char **argv) {
 		  options.fc = 8000;
 		}
 		break;
+      case 'x': options.decimate = true;
+		options.SRCaction |= 1;
+		break;
       case 'm': options.channels = 1;
 		break;
       case 'M': options.channels = 2;
 		break;
+      case 'K': options.channels = atoi(optarg);
+		if((options.channels < 1) || (options.channels > MAX_CHANNELS)) {
+		  cerr <<"EE: The channels decoded independently must be in the range [1-" <<MAX_CHANNELS <<"]. Setting default -> 2\n";
+		  options.channels = 2;
+		}
+		options.split = true;
+		options.SRCaction |= 1;
+		break;
       case 'c': options.soundDev = optarg;
 		break;
+      case 'j': options.fragsize = options.tlength = atof(optarg);
+		if(options.fragsize <= 0.0) {
+		  cerr <<"EE: The latency must be positive. The sound server chooses it\n";
+		  options.fragsize = options.tlength = -1.0;
+		}
+		break;
+      case 'J': if(sscanf(optarg, "%lf,%lf,%lf", &options.fragsize, &options.tlength, &options.prebuf) < 1) {
+		  cerr <<"EE: The buffer attributes must be FRAG[,TLEN[,PREBUF]] in ms. The sound server chooses them\n";
+		  options.fragsize = options.tlength = options.prebuf = -1.0;
+		}
+		break;
+      case 'Q': options.s16 = true;
+		break;
       case 'D': options.delay = atol(optarg);
 		options.SRCaction |= 1;
 		break;
@@ -283,6 +575,12 @@ int main(int argc, char **argv) {
 		break;
       case 'L': options.logfile = optarg;
 		break;
+      case 'u': options.async_log = optarg ? atoi(optarg) : ASYNC_RING/1024;
+		if(options.async_log <= 0) {
+		  cerr <<"EE: The ring of the logs must be positive. Setting default -> " <<ASYNC_RING/1024 <<" KB\n";
+		  options.async_log = ASYNC_RING/1024;
+		}
+		break;
       case 'R': options.repeat = atoi(optarg);
 		break;
       case 'w': print_warranty();
@@ -299,6 +597,13 @@ int main(int argc, char **argv) {
     }
   }
 
+  if(options.impair && (options.corpus <= 0)) {
+    cerr <<"EE: The impairments apply to the corpus: give its minutes with -X\n";
+    return 1;
+  }
+
+  if(options.repeat < 0)	// the discipline and the reference clock take one minute after the other
+    options.repeat = (options.discipline || (options.shm >= 0) || options.sock) ? 0 : 1;
   
   if(options.verb >= 4) {
     cout <<"Option passed:\n\n"
@@ -307,16 +612,31 @@ int main(int argc, char **argv) {
 	 <<"random_theta: " <<options.random_theta <<'\n'
 	 <<"random_samples: " <<options.random_samples <<'\n'
 	 <<"System sincronisation: " <<options.sys_sync <<'\n'
+	 <<"Clock discipline: " <<options.discipline <<" (step threshold " <<options.step <<" ms)\n"
+	 <<"SHM unit: " <<options.shm <<'\n'
 	 <<"Power level: " <<options.power <<" dB\n"
 	 <<"Do sync: " <<options.do_sync <<'\n'
 	 <<"Verbose level: " <<options.verb <<'\n'
+	 <<"Summary of the stages: " <<options.stats <<'\n'
 	 <<"WDS: " <<options.wds <<'\n'
 	 <<"SNR level: " <<options.snr_level <<'\n'
+	 <<"Noise estimator: " <<options.estimator <<" (percentile " <<options.percentile <<")\n"
+	 <<"Frame detection score: " <<options.frame <<'\n'
+	 <<"Frame correction: " <<options.corrections <<" bits\n"
+	 <<"Frame tracking: " <<options.track <<'\n'
+	 <<"Buffer attributes: " <<options.fragsize <<", " <<options.tlength <<", " <<options.prebuf <<" ms\n"
 	 <<"Noise RMS: " <<options.noise <<'\n'
+	 <<"Seed: " <<(options.seeded ? std::to_string(options.seed) : "random") <<'\n'
+	 <<"Corpus: " <<options.corpus <<" minutes; " <<options.corpus_threads <<" threads\n"
 	 <<"Change date: " <<options.chdate <<'\n'
 	 <<"Leap second: " <<options.leap <<'\n'
 	 <<"Sampling frequency: " <<options.fc <<" Hz\n"
+	 <<"Decimation: " <<options.decimate <<'\n'
+	 <<"Batch scan: " <<options.scan <<'\n'
+	 <<"Pool threads: " <<options.threads <<" (" <<(options.pool ? "on" : "off") <<")\n"
 	 <<"Channels: " <<options.channels <<'\n'
+	 <<"16 bit samples: " <<options.s16 <<'\n'
+	 <<"Independent channels: " <<options.split <<'\n'
 	 <<"Repeat: " <<options.repeat <<'\n'
 	 <<"Timeout: " <<options.timeout <<'\n'
 	 <<"Sync delay: " <<options.delay <<'\n';
@@ -324,14 +644,27 @@ int main(int argc, char **argv) {
     if(options.fo) cout <<"FileStream: " <<options.fo <<'\n';
     if(options.soundDev) cout <<"Sound device: " <<options.soundDev <<'\n';
     if(options.logfile) cout <<"Logfile: " <<options.logfile <<'\n';
+    if(options.async_log) cout <<"Asyncronous log: " <<options.async_log <<" KB\n";
     if(options.setDate) cout <<"Set date: " <<options.setDate <<'\n';
+    if(options.sock) cout <<"Refclock socket: " <<options.sock <<'\n';
+    if(options.metrics) cout <<"Metrics: " <<options.metrics <<'\n';
+    if(options.impair) cout <<"Impairments: " <<options.impair <<'\n';
     cout <<'\n';
   }
   
   SRC.set_verbose(options.verb);
+  SRC.set_noise_estimator(options.estimator, options.percentile);
+  SRC.set_corrections(options.corrections);
+  if(options.track) SRC.set_tracking(true, options.track == 2);
+  if(options.seeded) SRC.set_seed(options.seed);
+  SRC.set_buffer_attr(lround(options.fragsize*1000), lround(options.tlength*1000), lround(options.prebuf*1000));
   
   if(options.logfile) SRC.logOnFile(options.logfile);
   else SRC.logOnSTDOUT();
+  if(options.async_log) {
+    Clog::setRingSize(options.async_log*1024);
+    SRC.logAsync(true);
+  }
 
   if(options.do_sync) SRC.yes_sync();
   else SRC.no_sync();
@@ -343,17 +676,126 @@ int main(int argc, char **argv) {
   }
 
 
+  if(options.pool) {		// all the inputs on a pool of threads
+    if((optind >= argc) || (options.SRCaction != 1)) {
+      cerr <<"EE: The pool decodes the inputs listed after the options\n";
+      return 1;
+    }
+
+    SRC.set_decimation(options.decimate);
+    SRC.set_decision_threshold(options.th);
+    SRC.setWDS(options.wds, options.snr_level);
+    SRC.set_frame_detection(options.frame);
+    SRC.set_timeout(options.timeout);
+
+    Cengine engine(SRC);
+    for(int i = optind; i < argc; i++) {
+      if(engine.add(argv[i], options.fc, options.channels, options.s16) < 0) {
+        cerr <<"EE: Unable to open the input " <<argv[i] <<'\n';
+        return 1;
+      }
+    }
+
+    engine.set_repeat(options.repeat);
+    engine.set_iso(options.iso);
+    engine.on_report([&options](const Creport& r) {
+      if(!r.decoded) {
+        if(options.verb >= 0) cerr <<r.stream <<'\t' <<r.input <<"\tdecoding error " <<r.error <<'\n';
+        return;
+      }
+      cout <<r.stream <<'\t' <<r.input <<'\t' <<r.minute.date <<"\tframe " <<r.minute.frame;
+      if(r.minute.sync >= 0) cout <<"\tsync " <<r.minute.sync <<"\tRP " <<r.minute.ticks.size();
+      cout <<'\n';
+      cout.flush();
+    });
+
+    engine.run(options.threads);
+
+    return 0;
+  }
+
+
+  if(options.scan) {		// every minute of the file
+    if(!options.fo || (options.SRCaction != 1)) {
+      cerr <<"EE: The batch scan decodes a file: options -d and -f are required\n";
+      return 1;
+    }
+
+    Cscanner scanner(SRC);
+    if(!scanner.open(options.fo, options.fc, options.channels, options.s16)) {
+      cerr <<"EE: Unable to map the file " <<options.fo <<'\n';
+      return 1;
+    }
+
+    SRC.set_decision_threshold(options.th);
+    SRC.setWDS(options.wds, options.snr_level);
+    SRC.set_frame_detection(options.frame);
+    SRC.set_timeout(options.timeout);
+    scanner.set_iso(options.iso);
+    scanner.scan();
+
+    for(unsigned int i = 0; i < scanner.minutes().size(); i++) {
+      const Cminute& m = scanner.minutes()[i];
+
+      cout <<m.frame <<'\t' <<std::fixed <<std::setprecision(4) <<double(m.frame)/options.fc <<'\t' <<m.date;
+      if(m.sync >= 0)	// the end of the last RP, 100 ms after the second 0 of the next minute
+        cout <<"\tsync " <<m.sync <<'\t' <<std::setprecision(6) <<(m.sync + m.fraction)/options.fc <<"\tRP " <<m.ticks.size();
+      cout <<'\n';
+      if(options.verb >= 2) {
+        for(unsigned int j = 0; j < m.ticks.size(); j++) cout <<"\tRP " <<(j+1) <<": " <<m.ticks[j] <<'\n';
+      }
+    }
+    if(options.verb >= 1) cerr <<scanner.minutes().size() <<" minutes decoded in " <<scanner.length_samples()/options.fc <<" seconds of signal\n";
+
+    return 0;
+  }
+
+
+  const pa_sample_format format = options.s16 ? PA_SAMPLE_S16LE : PA_SAMPLE_FLOAT32LE;
+  Cservo servo(options.step*1e-3);
+  std::unique_ptr<Csysclock> kernel;	// destroyed on every return: it gives the kernel its discipline back
+
+  if(options.discipline) {	// the servo starts from the frequency correction of the kernel
+    struct sigaction action = {};
+
+    kernel.reset(new Csysclock);
+    servo.reset(kernel->frequency());
+
+    action.sa_handler = stop;	// no SA_RESTART: a blocked reading returns and the loop ends, restoring the kernel
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+  }
+
+  Crefclock refclock;
+  if((options.shm >= 0) && !refclock.open_shm(options.shm)) {
+    cerr <<"EE: Unable to attach the SHM segment of the unit " <<options.shm <<'\n';
+    return 1;
+  }
+  if(options.sock && !refclock.open_sock(options.sock)) {
+    cerr <<"EE: Unable to create the socket for " <<options.sock <<'\n';
+    return 1;
+  }
+  Cmetrics metrics;
+  if(options.metrics) {
+    if(!metrics.open(options.metrics)) {
+      cerr <<"EE: Unable to export the metrics on " <<options.metrics <<'\n';
+      return 1;
+    }
+    SRC.set_metrics(&metrics);	// the decoder of SRC only: not the independent channels
+  }
+
   do {	// repetition loop
     if(options.SRCaction == 1) {
+      SRC.set_decimation(options.decimate);
       if(options.fo) {
-        openState = SRC.open_file_input(options.fo, options.fc, options.channels);
+        openState = SRC.open_file_input(options.fo, options.fc, options.channels, format);
         if(!openState) { 
 	  cerr <<"EE: Unable to open input stream file " <<options.fo <<'\n';
 	  return 1;
         }
       }
       else {
-        openState = SRC.open_soundStream_input(options.fc, options.channels, options.soundDev);
+        openState = SRC.open_soundStream_input(options.fc, options.channels, options.soundDev, format);
         if(!openState) {
 	  cerr <<"EE: Unable to open sound input stream. " <<SRC.get_sound_error() <<'\n';
 	  return 1;
@@ -363,34 +805,53 @@ int main(int argc, char **argv) {
 
       SRC.set_decision_threshold(options.th);
       SRC.setWDS(options.wds, options.snr_level);
+      SRC.set_frame_detection(options.frame);
       SRC.set_timeout(options.timeout);
-      SRC.decode();
-
-      error = SRC.internalError();
-      if(options.sys_sync && SRC.sincronized()) {		// syncronisation of the system clock
-        struct timeval t;
-        struct timezone tz;	// timezone
-        tm ttmm;
-
-        tz.tz_minuteswest = 60*(1 + int(SRC.OE()));
-//      tz.tz_dsttime = DST_MET;		// central europe dst time constant. For old systems....
-
-        ttmm = SRC.get_date_tm();	// 1) return the tm structure of the date/time
-        t.tv_sec  = mktime(&ttmm);	// 2) convert the current time to the number of seconds since the "epoc"
-// 3) set the number of microseonds. These are calculated taking into account the delay since last reading plus an uncertainty value
-        t.tv_usec = SRC.getMilliseconds()*1000l + SRC.microsecDelay() + options.delay;
+      if(options.split) {	// one decoder for each channel
+        Cchannels receivers(SRC);
+        const Csrc* reference = NULL;	// the first channel syncronised sets the system clock
+
+        receivers.set_iso(options.iso);
+        receivers.decode();
+
+        for(int k = 0; k < receivers.size(); k++) {
+          const Csrc& ch = receivers.channel(k);
+          const Cminute& m = receivers.minute(k);
+
+          if(!ch.OK()) {
+            if(options.verb >= 0) cerr <<"Channel " <<(k+1) <<": decoding error!\n";
+            continue;
+          }
+          if(options.verb >= 0) {
+            cout <<(k+1) <<'\t' <<m.date <<"\tframe " <<m.frame;
+            if(m.sync >= 0)	// the end of the last RP, 100 ms after the second 0 of the next minute
+              cout <<"\tsync " <<m.sync <<'\t' <<std::fixed <<std::setprecision(6) <<(m.sync + m.fraction)/SRC.get_sample_frequency();
+            cout <<'\n';
+            if(options.binary) cout <<ch <<'\n';
+          }
+          if(ch.sincronized() && (reference == NULL)) reference = &ch;
+        }
 
-        error = settimeofday(&t, &tz);
-        if(error == 0) cout <<"System clock updated!!\n" <<SRC.dateSTD() <<'\n';
-        else cerr <<"EE: Unable to syncronise the system clock.\n";
+        if(reference == NULL) error = (SRC.internalError() == -3) ? -3 : receivers.channel(0).internalError();
+        else error = 0;
+        if(options.sys_sync && reference)
+          error = kernel ? discipline_clock(*reference, options.delay, *kernel, servo, options.verb) : sync_system_clock(*reference, options.delay);
+        if(refclock.is_open() && reference) error = publish_sample(*reference, options.delay, refclock, options.verb);
+      }
+      else {
+        SRC.decode();
 
+        error = SRC.internalError();
+        if(options.sys_sync && SRC.sincronized())
+          error = kernel ? discipline_clock(SRC, options.delay, *kernel, servo, options.verb) : sync_system_clock(SRC, options.delay);
+        if(refclock.is_open() && SRC.sincronized()) error = publish_sample(SRC, options.delay, refclock, options.verb);
       }
     }
     else if(options.SRCaction == 2) {
       if(options.fo)
-        SRC.open_file_output(options.fo, options.fc, options.channels);
+        SRC.open_file_output(options.fo, options.fc, options.channels, format);
       else
-        SRC.open_soundStream_output(options.fc, options.channels, options.soundDev);
+        SRC.open_soundStream_output(options.fc, options.channels, options.soundDev, format);
     
       if(SRC.get_OUTstate() == 0) {
         cerr <<"Error in opening output stream!\n";
@@ -406,20 +867,46 @@ int main(int argc, char **argv) {
         default: break;
       }
 
-      if((options.chdate != 7) || (options.leap != 0))
-        SRC.setWarnings(options.chdate, options.leap);
-    
-      SRC.play(options.power, options.random_samples, options.random_theta, options.noise);
+      if(options.corpus > 0) {	// the warnings follow the calendar
+        Ccorpus corpus(SRC);
+        std::ofstream labels;
+
+        if(!corpus.set_impairments(options.impair)) {
+          cerr <<"EE: Wrong impairments or unreadable program audio: " <<options.impair <<'\n';
+          return 1;
+        }
+        if(options.fo) {
+          labels.open((std::string(options.fo) + ".labels").c_str());
+          corpus.set_labels(&labels);
+        }
+        corpus.set_power(options.power);
+        corpus.set_noise(options.noise);
+        corpus.set_leap_second(options.leap);
+        corpus.set_iso(options.iso);
+        if(options.seeded) corpus.set_seed(options.seed);
+
+        if(corpus.generate(options.corpus, options.corpus_threads) < 0) error = 1;
+        options.repeat = 1;	// the corpus is already continuous
+      }
+      else {
+        if((options.chdate != 7) || (options.leap != 0))
+          SRC.setWarnings(options.chdate, options.leap);
+
+        SRC.play(options.power, options.random_samples, options.random_theta, options.noise);
+      }
       if(options.verb >= 1) {
         cout <<SRC.dateSTR(options.iso) <<'\n';
         if(options.binary) cout <<SRC <<'\n';
       }
     }
+    if(options.async_log) Clog::sync();	// the logs of the decoding come before its result
   
     if(options.verb >= 0) {
-      if(options.SRCaction == 1) {
+      if((options.SRCaction == 1) && !options.split) {
         if(SRC.OK()) {
 	  cout <<SRC.dateSTR(options.iso) <<'\n';
+	  if((options.corrections > 0) && (options.verb >= 1))
+	    cout <<"Confidence: " <<SRC.get_confidence() <<" dB; bits corrected: " <<SRC.corrected_bits() <<'\n';
 	  if(SRC.warnings() && (options.verb >= 1)) {
 	    cout <<"---------------\nSRC WARNINGS:\n";
 	    if(SRC.SE() != 7) cout <<"Change time in " <<SRC.SE() <<" days\n";
@@ -437,8 +924,15 @@ int main(int argc, char **argv) {
 
     SRC.close_all();
     options.repeat--;
-  } while(options.repeat != 0);
+  } while((options.repeat != 0) && !stopping);
 
+  SRC.log_stats(options.stats);
+  if(options.async_log) {
+    Clog::sync();
+    if((Clog::dropped() > 0) && (options.verb >= 1)) cerr <<"WW: " <<Clog::dropped() <<" log records dropped: the ring of the logs was full\n";
+  }
+  refclock.close_all();
+  metrics.close_all();
 
   return error;
 }